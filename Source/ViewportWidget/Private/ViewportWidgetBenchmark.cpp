@@ -0,0 +1,414 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#include "Widgets/SViewportWidget.h"
+#include "CustomViewportClient.h"
+
+#include "Containers/Ticker.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Framework/Application/SlateApplication.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Slate/WidgetRenderer.h"
+#include "UObject/StrongObjectPtr.h"
+#include "UObject/UObjectArray.h"
+#include "Widgets/Layout/SBox.h"
+#include "Widgets/Layout/SUniformGridPanel.h"
+
+#if !UE_BUILD_SHIPPING
+
+DEFINE_LOG_CATEGORY_STATIC(LogViewportWidgetBenchmark, Log, All);
+
+static TAutoConsoleVariable<float> CVarViewportWidgetBenchmarkThreshold(
+	TEXT("r.ViewportWidget.BenchmarkThreshold"),
+	.2f,
+	TEXT("Fraction by which a ViewportWidget.Benchmark result may exceed its baseline before it is reported as a regression."),
+	ECVF_Default);
+
+//------------------------------------------------------
+// FViewportWidgetBenchmark
+//------------------------------------------------------
+
+/**
+ * Measures the game thread cost of many viewport widgets, one scenario after the other over real frames:
+ * visible widgets rendering in realtime, static widgets rendering on demand and hidden widgets.
+ * The widgets are laid out in a grid drawn each frame by a widget renderer into a render target, so they are ticked and painted
+ * as in a window without one being on screen.
+ */
+class FViewportWidgetBenchmark : public TSharedFromThis<FViewportWidgetBenchmark>
+{
+public:
+	enum class EScenario : uint8
+	{
+		Visible,
+		Static,
+		Hidden,
+		Count
+	};
+
+	struct FResult
+	{
+		FString Scenario;
+		double TickMs = 0;
+		double SpawnMs = 0;
+		double RespawnMs = 0;
+		double MemoryPerWorldKB = 0;
+
+		/** UObjects created per widget, standing in for an allocation count, which the engine does not keep outside of memory tracing */
+		double ObjectsPerWidget = 0;
+	};
+
+	FViewportWidgetBenchmark(int32 InNumWidgets, int32 InNumEntries, int32 InNumFrames, UClass* InEntryClass, const FString& InBaselineFilename)
+		: NumWidgets(InNumWidgets)
+		, NumEntries(InNumEntries)
+		, NumFrames(InNumFrames)
+		, EntryClass(InEntryClass)
+		, BaselineFilename(InBaselineFilename)
+		, Scenario(EScenario::Visible)
+		, Frame(0)
+		, TickSeconds(0)
+		, bFailed(false)
+	{}
+
+	/** @return True if a result regressed against the baseline, or the baseline could not be read */
+	bool HasFailed() const { return bFailed; }
+
+	/** @return False once every scenario has run and the results are written */
+	bool Tick(float DeltaTime)
+	{
+		if (Frame == 0)
+		{
+			BeginScenario();
+		}
+
+		// Painting ticks the widgets, as a window would
+		const double startTime = FPlatformTime::Seconds();
+		WidgetRenderer->DrawWidget(RenderTarget.Get(), Host.ToSharedRef(), DrawSize, DeltaTime);
+
+		// The first frames spawn and settle, they are not part of the steady state
+		if (Frame >= WarmupFrames)
+		{
+			TickSeconds += FPlatformTime::Seconds() - startTime;
+		}
+
+		if (++Frame < WarmupFrames + NumFrames)
+		{
+			return true;
+		}
+
+		EndScenario();
+
+		Scenario = (EScenario)((uint8)Scenario + 1);
+		Frame = 0;
+
+		if (Scenario != EScenario::Count)
+		{
+			return true;
+		}
+
+		bFailed = !WriteResults();
+		return false;
+	}
+
+private:
+	static const TCHAR* GetScenarioName(EScenario InScenario)
+	{
+		switch (InScenario)
+		{
+		case EScenario::Visible: return TEXT("Visible");
+		case EScenario::Static: return TEXT("Static");
+		case EScenario::Hidden: return TEXT("Hidden");
+		default: return TEXT("Unknown");
+		}
+	}
+
+	TArray<FViewportWidgetEntry> MakeEntries(float Offset) const
+	{
+		TArray<FViewportWidgetEntry> entries;
+		for (int32 i = 0; i < NumEntries; i++)
+		{
+			FViewportWidgetEntry& entry = entries.AddDefaulted_GetRef();
+			entry.ActorClassPtr = EntryClass.Get();
+			entry.SpawnTransform = FTransform(FVector(i * 100.f + Offset, 0, 0));
+		}
+
+		return entries;
+	}
+
+	void BeginScenario()
+	{
+		Result = FResult();
+		Result.Scenario = GetScenarioName(Scenario);
+		TickSeconds = 0;
+
+		const uint64 usedMemory = FPlatformMemory::GetStats().UsedPhysical;
+		const int32 numObjects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+		// Size of each widget in the grid, in Slate units
+		const float cellSize = 128.f;
+		const int32 numColumns = FMath::CeilToInt(FMath::Sqrt((float)NumWidgets));
+		TSharedRef<SUniformGridPanel> grid = SNew(SUniformGridPanel);
+
+		double spawnSeconds = 0;
+		for (int32 i = 0; i < NumWidgets; i++)
+		{
+			TSharedPtr<SViewportWidget> viewport = SNew(SViewportWidget);
+			viewport->GetViewportClient()->SetDrawWhenAppIsHidden(true);
+			viewport->SetRedrawMode(Scenario == EScenario::Visible ? EViewportWidgetRedrawMode::Realtime : EViewportWidgetRedrawMode::OnDemand);
+			viewport->SetVisibility(Scenario == EScenario::Hidden ? EVisibility::Collapsed : EVisibility::Visible);
+
+			// The world is created on the first paint otherwise, it has to exist for the memory and spawn measures
+			viewport->Prewarm();
+
+			TArray<FViewportWidgetEntry> entries = MakeEntries(0);
+
+			const double startTime = FPlatformTime::Seconds();
+			viewport->SetEntries(entries);
+			spawnSeconds += FPlatformTime::Seconds() - startTime;
+
+			Viewports.Add(viewport);
+
+			grid->AddSlot(i % numColumns, i / numColumns)
+			[
+				SNew(SBox)
+				.WidthOverride(cellSize)
+				.HeightOverride(cellSize)
+				[
+					viewport.ToSharedRef()
+				]
+			];
+		}
+
+		Host = grid;
+		DrawSize = FVector2D(numColumns, FMath::DivideAndRoundUp(NumWidgets, numColumns)) * cellSize;
+
+		if (!WidgetRenderer.IsValid())
+		{
+			WidgetRenderer = MakeShared<FWidgetRenderer>();
+		}
+
+		if (!RenderTarget.IsValid())
+		{
+			RenderTarget.Reset(FWidgetRenderer::CreateTargetFor(DrawSize, TF_Default, false));
+		}
+		else
+		{
+			RenderTarget->ResizeTarget(DrawSize.X, DrawSize.Y);
+		}
+
+		const int32 numWidgets = FMath::Max(NumWidgets, 1);
+		Result.SpawnMs = spawnSeconds * 1000. / numWidgets;
+		Result.MemoryPerWorldKB = ((int64)FPlatformMemory::GetStats().UsedPhysical - (int64)usedMemory) / 1024. / numWidgets;
+		Result.ObjectsPerWidget = (GUObjectArray.GetObjectArrayNumMinusAvailable() - numObjects) / (double)numWidgets;
+	}
+
+	void EndScenario()
+	{
+		Result.TickMs = TickSeconds * 1000. / FMath::Max(NumFrames, 1);
+
+		// Clearing then setting the entries again goes through the actor pool, moving them reuses the actors in place
+		double respawnSeconds = 0;
+		for (const TSharedPtr<SViewportWidget>& viewport : Viewports)
+		{
+			TArray<FViewportWidgetEntry> noEntries;
+			TArray<FViewportWidgetEntry> entries = MakeEntries(0);
+			TArray<FViewportWidgetEntry> movedEntries = MakeEntries(50.f);
+
+			const double startTime = FPlatformTime::Seconds();
+			viewport->SetEntries(noEntries);
+			viewport->SetEntries(entries);
+			viewport->SetEntries(movedEntries);
+			respawnSeconds += FPlatformTime::Seconds() - startTime;
+		}
+
+		Result.RespawnMs = respawnSeconds * 1000. / FMath::Max(NumWidgets, 1);
+
+		UE_LOG(LogViewportWidgetBenchmark, Display, TEXT("%s: tick %.3f ms/frame, spawn %.3f ms, respawn %.3f ms, %.1f KB and %.1f UObjects per widget"),
+			*Result.Scenario, Result.TickMs, Result.SpawnMs, Result.RespawnMs, Result.MemoryPerWorldKB, Result.ObjectsPerWidget);
+
+		Results.Add(Result);
+		Host.Reset();
+		Viewports.Reset();
+	}
+
+	static FString GetCsvHeader()
+	{
+		return TEXT("Scenario,Widgets,Entries,TickMs,SpawnMs,RespawnMs,MemoryPerWorldKB,ObjectsPerWidget");
+	}
+
+	FString ToCsvLine(const FResult& InResult) const
+	{
+		return FString::Printf(TEXT("%s,%d,%d,%.4f,%.4f,%.4f,%.2f,%.2f"), *InResult.Scenario, NumWidgets, NumEntries,
+			InResult.TickMs, InResult.SpawnMs, InResult.RespawnMs, InResult.MemoryPerWorldKB, InResult.ObjectsPerWidget);
+	}
+
+	/** @return False if a result regressed against the baseline */
+	bool WriteResults() const
+	{
+		TArray<FString> lines;
+		lines.Add(GetCsvHeader());
+		for (const FResult& result : Results)
+		{
+			lines.Add(ToCsvLine(result));
+		}
+
+		const FString filename = FPaths::ProfilingDir() / TEXT("ViewportWidgetBenchmark") / FString::Printf(TEXT("Benchmark-%s.csv"), *FDateTime::Now().ToString());
+		if (FFileHelper::SaveStringArrayToFile(lines, *filename))
+		{
+			UE_LOG(LogViewportWidgetBenchmark, Display, TEXT("Results written to %s"), *filename);
+		}
+
+		return BaselineFilename.IsEmpty() || CompareToBaseline();
+	}
+
+	/**
+	 * Reports every result slower or larger than the baseline row of the same scenario, widget and entry counts by more than the threshold
+	 * @return False if a result regressed or the baseline could not be read
+	 */
+	bool CompareToBaseline() const
+	{
+		TArray<FString> baselineLines;
+		if (!FFileHelper::LoadFileToStringArray(baselineLines, *BaselineFilename))
+		{
+			UE_LOG(LogViewportWidgetBenchmark, Error, TEXT("Cannot read the baseline %s"), *BaselineFilename);
+			return false;
+		}
+
+		const float threshold = CVarViewportWidgetBenchmarkThreshold.GetValueOnGameThread();
+		const TCHAR* metricNames[] = { TEXT("TickMs"), TEXT("SpawnMs"), TEXT("RespawnMs"), TEXT("MemoryPerWorldKB"), TEXT("ObjectsPerWidget") };
+
+		int32 numRegressions = 0;
+		for (const FResult& result : Results)
+		{
+			const double values[] = { result.TickMs, result.SpawnMs, result.RespawnMs, result.MemoryPerWorldKB, result.ObjectsPerWidget };
+
+			for (const FString& baselineLine : baselineLines)
+			{
+				TArray<FString> columns;
+				baselineLine.ParseIntoArray(columns, TEXT(","), false);
+
+				if (columns.Num() != 8 || columns[0] != result.Scenario || FCString::Atoi(*columns[1]) != NumWidgets || FCString::Atoi(*columns[2]) != NumEntries)
+				{
+					continue;
+				}
+
+				for (int32 i = 0; i < UE_ARRAY_COUNT(values); i++)
+				{
+					const double baseline = FCString::Atod(*columns[i + 3]);
+					if (values[i] > baseline * (1. + threshold) && values[i] - baseline > KINDA_SMALL_NUMBER)
+					{
+						UE_LOG(LogViewportWidgetBenchmark, Error, TEXT("%s %s regressed: %.4f against a baseline of %.4f"), *result.Scenario, metricNames[i], values[i], baseline);
+						numRegressions++;
+					}
+				}
+			}
+		}
+
+		if (numRegressions == 0)
+		{
+			UE_LOG(LogViewportWidgetBenchmark, Display, TEXT("No regression against %s"), *BaselineFilename);
+		}
+
+		return numRegressions == 0;
+	}
+
+	static const int32 WarmupFrames = 10;
+
+	int32 NumWidgets;
+	int32 NumEntries;
+	int32 NumFrames;
+	TStrongObjectPtr<UClass> EntryClass;
+	FString BaselineFilename;
+
+	EScenario Scenario;
+	int32 Frame;
+	double TickSeconds;
+	bool bFailed;
+
+	FResult Result;
+	TArray<FResult> Results;
+
+	TArray<TSharedPtr<SViewportWidget>> Viewports;
+
+	/** Grid of the scenario's widgets, drawn each frame */
+	TSharedPtr<SWidget> Host;
+	FVector2D DrawSize;
+
+	TSharedPtr<FWidgetRenderer> WidgetRenderer;
+	TStrongObjectPtr<UTextureRenderTarget2D> RenderTarget;
+};
+
+static TSharedPtr<FViewportWidgetBenchmark> ActiveBenchmark;
+
+static FAutoConsoleCommand ViewportWidgetBenchmarkCommand(
+	TEXT("ViewportWidget.Benchmark"),
+	TEXT("Measures the cost of viewport widgets and writes a CSV to the profiling directory. ")
+	TEXT("Arguments: Widgets=32 Entries=8 Frames=120 EntryClass=/Script/Engine.StaticMeshActor Baseline=<csv to compare against> ")
+	TEXT("-Exit to quit once done, with exit code 1 if a result regressed"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		if (ActiveBenchmark.IsValid())
+		{
+			UE_LOG(LogViewportWidgetBenchmark, Warning, TEXT("A benchmark is already running"));
+			return;
+		}
+
+		if (!FSlateApplication::IsInitialized())
+		{
+			UE_LOG(LogViewportWidgetBenchmark, Error, TEXT("The benchmark needs Slate, run it from the game or the editor"));
+			return;
+		}
+
+		const FString commandLine = FString::Join(Args, TEXT(" "));
+
+		int32 numWidgets = 32;
+		int32 numEntries = 8;
+		int32 numFrames = 120;
+		FString entryClassPath = AStaticMeshActor::StaticClass()->GetPathName();
+		FString baselineFilename;
+		FParse::Value(*commandLine, TEXT("Widgets="), numWidgets);
+		FParse::Value(*commandLine, TEXT("Entries="), numEntries);
+		FParse::Value(*commandLine, TEXT("Frames="), numFrames);
+		FParse::Value(*commandLine, TEXT("EntryClass="), entryClassPath);
+		FParse::Value(*commandLine, TEXT("Baseline="), baselineFilename);
+		const bool bExitWhenDone = FParse::Param(*commandLine, TEXT("Exit"));
+
+		UClass* entryClass = LoadObject<UClass>(nullptr, *entryClassPath);
+		if (!entryClass || !entryClass->IsChildOf(AActor::StaticClass()))
+		{
+			UE_LOG(LogViewportWidgetBenchmark, Error, TEXT("%s is not an actor class"), *entryClassPath);
+			return;
+		}
+
+		ActiveBenchmark = MakeShared<FViewportWidgetBenchmark>(FMath::Max(numWidgets, 1), FMath::Max(numEntries, 0), FMath::Max(numFrames, 1), entryClass, baselineFilename);
+
+		FTickerDelegate tickDelegate = FTickerDelegate::CreateLambda([bExitWhenDone](float DeltaTime)
+		{
+			if (ActiveBenchmark.IsValid() && ActiveBenchmark->Tick(DeltaTime))
+			{
+				return true;
+			}
+
+			// Automation runs read the result from the exit code
+			if (bExitWhenDone)
+			{
+				const bool bFailed = !ActiveBenchmark.IsValid() || ActiveBenchmark->HasFailed();
+				FPlatformMisc::RequestExitWithStatus(false, bFailed ? 1 : 0);
+			}
+
+			ActiveBenchmark.Reset();
+			return false;
+		});
+
+#if ENGINE_MAJOR_VERSION >= 5
+		FTSTicker::GetCoreTicker().AddTicker(tickDelegate);
+#else
+		FTicker::GetCoreTicker().AddTicker(tickDelegate);
+#endif
+	}));
+
+#endif
@@ -1,10 +1,14 @@
 // Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
 
 #include "ViewportWidgetModule.h"
+#include "ViewportWidgetStats.h"
 #include "CustomViewportClient.h"
 #include "CustomPreviewScene.h"
 #include "Widgets/SViewportWidget.h"
 #include "Components/ViewportWidget.h"
+#include "ViewportWidgetSettings.h"
+#include "ViewportOffscreenRenderer.h"
+#include "ViewportViewBatcher.h"
 
 #include "UObject/UObjectGlobals.h"
 
@@ -22,21 +26,84 @@
 #include "Components/LineBatchComponent.h"
 #include "Components/MeshComponent.h"
 #include "Components/StaticMeshComponent.h"
+#include "Components/SkeletalMeshComponent.h"
 #include "EngineUtils.h"
 #include "Slate/SceneViewport.h"
 #include "Framework/Application/SlateApplication.h"
+#include "Widgets/SOverlay.h"
+#include "Widgets/Images/SImage.h"
+#include "Widgets/Layout/SBox.h"
+#include "Blueprint/UserWidget.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Engine/Texture2D.h"
+#include "ContentStreaming.h"
 
 #include "AudioDevice.h"
 #include "Components/SkyLightComponent.h"
 #include "Components/ReflectionCaptureComponent.h"
 #include "GameFramework/GameModeBase.h"
 
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/FileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/Compression.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+#include "Hash/CityHash.h"
+#include "RHI.h"
+#include "RHIGPUReadback.h"
+#include "Math/Float16Color.h"
+#include "RHICommandList.h"
+#include "RenderingThread.h"
+
 #define LOCTEXT_NAMESPACE "FInputSequenceToolsModule"
 
+//------------------------------------------------------
+// Stats
+//------------------------------------------------------
+
+DEFINE_STAT(STAT_ViewportWidget_NumWidgets);
+DEFINE_STAT(STAT_ViewportWidget_NumPreviewWorlds);
+DEFINE_STAT(STAT_ViewportWidget_NumEntryActors);
+DEFINE_STAT(STAT_ViewportWidget_NumRenders);
+
+CSV_DEFINE_CATEGORY_MODULE(VIEWPORTWIDGET_API, ViewportWidget, true);
+
+DECLARE_CYCLE_STAT(TEXT("Tick"), STAT_ViewportWidget_Tick, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Preview World Tick"), STAT_ViewportWidget_WorldTick, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Draw"), STAT_ViewportWidget_Draw, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Calc Scene View"), STAT_ViewportWidget_CalcSceneView, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Render View Batch"), STAT_ViewportWidget_RenderViewBatch, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Reconcile Entries"), STAT_ViewportWidget_ReconcileEntries, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Clean Entries"), STAT_ViewportWidget_CleanEntries, STATGROUP_ViewportWidget);
+DECLARE_CYCLE_STAT(TEXT("Load Entry Classes"), STAT_ViewportWidget_LoadEntryClasses, STATGROUP_ViewportWidget);
+
 //------------------------------------------------------
 // SViewportWidget
 //------------------------------------------------------
 
+/** How long a viewport is considered visible after its last tick, also the period of the occlusion test */
+static const float VisibilityTimeThreshold = .25f;
+
+/** How long after a change mips streamed in for the new view or entries still trigger a redraw */
+static const float TextureStreamingSettleTime = 5.f;
+
+static TAutoConsoleVariable<int32> CVarViewportWidgetTextureStreamingMaxScreenSize(
+	TEXT("r.ViewportWidget.TextureStreamingMaxScreenSize"),
+	1024,
+	TEXT("Largest screen size in pixels viewport widgets report to the texture streamer, which caps the mips their textures stream in. 0 means no limit."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarViewportWidgetTextureStreamingBoost(
+	TEXT("r.ViewportWidget.TextureStreamingBoost"),
+	1.f,
+	TEXT("Factor on the screen size viewport widgets report to the texture streamer. Below 1 previews stream lower mips."),
+	ECVF_Default);
+
 bool IsNotEqual(const TArray<FViewportWidgetEntry>& A, const TArray<FViewportWidgetEntry>& B)
 {
 	if (A.Num() != B.Num())
@@ -46,7 +113,21 @@ bool IsNotEqual(const TArray<FViewportWidgetEntry>& A, const TArray<FViewportWid
 
 	for (size_t i = 0; i < A.Num(); i++)
 	{
-		if ((A[i].ActorClassPtr != B[i].ActorClassPtr) || !(A[i].SpawnTransform.Equals(B[i].SpawnTransform)))
+		if ((A[i].ActorClassPtr != B[i].ActorClassPtr) || !(A[i].SpawnTransform.Equals(B[i].SpawnTransform)) || (A[i].bTickInPreview != B[i].bTickInPreview))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool IsActorAnimating(const AActor* actor)
+{
+	TInlineComponentArray<USkeletalMeshComponent*> skeletalMeshComponents(actor);
+	for (const USkeletalMeshComponent* skeletalMeshComponent : skeletalMeshComponents)
+	{
+		if (skeletalMeshComponent->IsPlaying() || (skeletalMeshComponent->GetAnimInstance() && !skeletalMeshComponent->bPauseAnims))
 		{
 			return true;
 		}
@@ -56,9 +137,61 @@ bool IsNotEqual(const TArray<FViewportWidgetEntry>& A, const TArray<FViewportWid
 }
 
 SViewportWidget::SViewportWidget() 
-	:PreviewScene(MakeShareable(new FPreviewScene(
-		FPreviewScene::ConstructionValues().SetCreateDefaultLighting(true).SetEditor(false).SetForceMipsResident(true)
-	))){}
+	: LastTickTime(0)
+	, bIsOnScreen(true)
+	, LastOcclusionCheckTime(0)
+	, bIsCovered(false)
+	, LastCullingRect(ForceInit)
+	, bUsesSharedScene(false)
+	, bBatchViews(false)
+	, bPendingCaptureRequest(false)
+	, bPendingCaptureInvalidation(false)
+	, EntryActorPoolSize(4)
+	, WorldProfile(EViewportWidgetWorldProfile::Full)
+	, bHasPendingEntries(false)
+	, bAsyncLoadEntries(false)
+	, TickAccumulator(0.f)
+	, RedrawMode(EViewportWidgetRedrawMode::Realtime)
+	, bRedrawRequested(true)
+	, RealtimeEndTime(0)
+	, UpdateDepth(0)
+	, bEntriesChangedInUpdate(false)
+	, bThumbnailCacheKeyChangedInUpdate(false)
+	, SnapshotFrameCount(4)
+	, SnapshotFramesRemaining(0)
+	, LastRenderedSize(FIntPoint::ZeroValue)
+	, LastCaptureGeneration(0)
+	, TextureStreamingEndTime(0)
+	, LastNumWantingStreamingResources(0)
+	, ThumbnailCacheKey(0)
+	, bShowingCachedThumbnail(false)
+	, bAwaitingInteraction(true)
+	, bThumbnailCaptured(false)
+{
+	INC_DWORD_STAT(STAT_ViewportWidget_NumWidgets);
+}
+
+SViewportWidget::~SViewportWidget()
+{
+	DEC_DWORD_STAT(STAT_ViewportWidget_NumWidgets);
+
+	if (FViewportWidgetModule* module = FViewportWidgetModule::GetPtr())
+	{
+		module->GetRenderScheduler().Unregister(this);
+		module->GetViewBatcher().RemoveViewport(this);
+	}
+
+	if (EntriesLoadHandle.IsValid())
+	{
+		EntriesLoadHandle->CancelHandle();
+	}
+
+	// A private scene goes away with its actors, a shared one has to be told we no longer use ours
+	if (bUsesSharedScene)
+	{
+		CleanEntries();
+	}
+}
 
 void SViewportWidget::Construct(const FArguments& InArgs)
 {
@@ -68,15 +201,50 @@ void SViewportWidget::Construct(const FArguments& InArgs)
 	//ParentArgs.RenderDirectlyToWindow(true);
 	SViewport::Construct(ParentArgs);
 
-	Client = MakeShareable(new FCustomUMGViewportClient(PreviewScene.Get()));
+	// The stand-in image is a child rather than drawn in OnPaint, so it sits between the scene and the content
+	SViewport::SetContent(
+		SNew(SOverlay)
+		+ SOverlay::Slot()
+		[
+			SNew(SImage)
+			.Visibility(EVisibility::HitTestInvisible)
+			.Image(this, &SViewportWidget::GetStandInBrush)
+		]
+		+ SOverlay::Slot()
+		[
+			SAssignNew(ContentBox, SBox)
+		]);
+
+	FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+
+	// The preview world is created once the viewport is first on screen, see EnsurePreviewScene
+	bUsesSharedScene = module && !InArgs._SharedSceneName.IsNone();
+	SharedSceneName = InArgs._SharedSceneName;
+	WorldProfile = InArgs._WorldProfile;
+
+	Client = MakeShareable(new FCustomUMGViewportClient());
 	SceneViewport = MakeShareable(new FSceneViewport(Client.Get(), SharedThis(this)));
 	SetViewportInterface(SceneViewport.ToSharedRef());
 
+	if (module)
+	{
+		module->GetRenderScheduler().Register(this);
+	}
+
 	SetViewTransform(InArgs._ViewTransform.Get(FTransform::Identity));
 
+	bAsyncLoadEntries = InArgs._AsyncLoadEntries;
+	OnEntriesReady = InArgs._OnEntriesReady;
+	ThumbnailCacheKey = InArgs._ThumbnailCacheKey;
+
 	SetEntries(const_cast<TArray<FViewportWidgetEntry>&>(InArgs._Entries.Get()));
 }
 
+void SViewportWidget::SetContent(TSharedPtr<SWidget> InContent)
+{
+	ContentBox->SetContent(InContent.IsValid() ? InContent.ToSharedRef() : SNullWidget::NullWidget);
+}
+
 void SViewportWidget::SetViewTransform(const FTransform& viewTransform)
 {
 	if (!ViewTransform.IsSet() || !(ViewTransform.Get().Equals(viewTransform)))
@@ -85,1188 +253,4277 @@ void SViewportWidget::SetViewTransform(const FTransform& viewTransform)
 
 		Client->SetViewLocation(viewTransform.GetLocation());
 		Client->SetViewRotation(viewTransform.Rotator());
+
+		RequestRedraw();
 	}
 }
 
 void SViewportWidget::SetEntries(TArray<FViewportWidgetEntry>& entries)
 {
-	if (!Entries.IsSet() || IsNotEqual(Entries.Get(), entries))
+	// While a load is in flight the pending entries are what the viewport is about to show
+	const bool bChanged = bHasPendingEntries ? IsNotEqual(PendingEntries, entries) : (!Entries.IsSet() || IsNotEqual(Entries.Get(), entries));
+	if (bChanged)
 	{
-		CleanEntries();
-		Entries = entries;
-		AddEntries();
+		PendingEntries = entries;
+		bHasPendingEntries = true;
+
+		if (UpdateDepth > 0)
+		{
+			bEntriesChangedInUpdate = true;
+			return;
+		}
+
+		LoadPendingEntries();
+	}
+}
+
+void SViewportWidget::EndUpdate()
+{
+	if (!ensure(UpdateDepth > 0) || --UpdateDepth > 0)
+	{
+		return;
+	}
+
+	// Same order as outside an update, the cached image of the new key can stand in for the new entries
+	if (bThumbnailCacheKeyChangedInUpdate)
+	{
+		bThumbnailCacheKeyChangedInUpdate = false;
+
+		const bool bWasShowingCachedThumbnail = bShowingCachedThumbnail;
+		RefreshCachedThumbnail();
+
+		// Waking from the cached image has already loaded the entries
+		if (bWasShowingCachedThumbnail && !bShowingCachedThumbnail)
+		{
+			bEntriesChangedInUpdate = false;
+		}
+	}
+
+	if (bEntriesChangedInUpdate)
+	{
+		bEntriesChangedInUpdate = false;
+		if (bHasPendingEntries)
+		{
+			LoadPendingEntries();
+		}
+	}
+}
+
+void SViewportWidget::LoadPendingEntries()
+{
+	if (EntriesLoadHandle.IsValid())
+	{
+		EntriesLoadHandle->CancelHandle();
+		EntriesLoadHandle.Reset();
+	}
+
+	// Until the user interacts, a cached image of the entries stands in for loading and spawning them
+	if (bAwaitingInteraction && ThumbnailCacheKey != 0 && LoadCachedThumbnail())
+	{
+		bShowingCachedThumbnail = true;
+		return;
+	}
+
+	// Loaded once the preview world is created
+	if (!PreviewScene.IsValid())
+	{
+		return;
+	}
+
+	TArray<FSoftObjectPath> classPaths;
+	if (bAsyncLoadEntries && UAssetManager::IsValid())
+	{
+		for (const FViewportWidgetEntry& ViewportWidgetEntry : PendingEntries)
+		{
+			if (!ViewportWidgetEntry.ActorClassPtr.IsNull() && !ViewportWidgetEntry.ActorClassPtr.Get())
+			{
+				classPaths.AddUnique(ViewportWidgetEntry.ActorClassPtr.ToSoftObjectPath());
+			}
+		}
+	}
+
+	if (classPaths.Num() == 0)
+	{
+		ApplyPendingEntries();
+		return;
+	}
+
+	// Only the load itself, the spawn that follows is counted by the reconcile
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_LoadEntryClasses);
+	CSV_SCOPED_TIMING_STAT(ViewportWidget, LoadEntryClasses);
+
+	EntriesLoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(classPaths,
+		FStreamableDelegate::CreateSP(this, &SViewportWidget::ApplyPendingEntries), FStreamableManager::AsyncLoadHighPriority);
+}
+
+void SViewportWidget::ApplyPendingEntries()
+{
+	EntriesLoadHandle.Reset();
+
+	if (!bHasPendingEntries)
+	{
+		return;
 	}
+
+	bAwaitingInteraction = false;
+
+	ReconcileEntries(PendingEntries);
+
+	PendingEntries.Reset();
+	bHasPendingEntries = false;
+
+	RequestRedraw();
+
+	OnEntriesReady.ExecuteIfBound();
 }
 
 void SViewportWidget::SetViewportBackgroudColor(FLinearColor InColor)
 {
-	Client->SetBackgroundColor(InColor);
+	if (!Client->GetBackgroundColor().Equals(InColor))
+	{
+		Client->SetBackgroundColor(InColor);
+		RequestRedraw();
+	}
 }
 
 void SViewportWidget::SetViewportFOV(float InFOV)
 {
+	if (Client->GetViewFOV() == InFOV)
+	{
+		return;
+	}
+
 	Client->SetViewFOV(InFOV);
+	RequestRedraw();
 }
 
 void SViewportWidget::SetViewportSkyBrightness(float brightness)
 {
+	if (!PreviewScene.IsValid())
+	{
+		PendingSkyBrightness = brightness;
+		return;
+	}
+
+	if (PreviewScene->GetSkyBrightness() == brightness)
+	{
+		return;
+	}
+
 	PreviewScene->SetSkyBrightness(brightness);
+	RequestRedraw();
 }
 
 void SViewportWidget::SetViewportCubemap(UTextureCube * InCubemap)
 {
-	PreviewScene->SetSkyCubemap(InCubemap);
-	PreviewScene->UpdateCaptureContents();
+	if (!PreviewScene.IsValid())
+	{
+		PendingCubemap = TWeakObjectPtr<UTextureCube>(InCubemap);
+		return;
+	}
+
+	// The viewport redraws once the capture is done, see Tick
+	PreviewScene->RequestCapture(InCubemap);
 }
 
 void SViewportWidget::UpdateCapture()
 {
-	PreviewScene->UpdateCaptureContents();
+	if (!PreviewScene.IsValid())
+	{
+		bPendingCaptureRequest = true;
+		return;
+	}
+
+	PreviewScene->RequestCapture();
+}
+
+void SViewportWidget::InvalidateCapture()
+{
+	if (!PreviewScene.IsValid())
+	{
+		bPendingCaptureInvalidation = true;
+		return;
+	}
+
+	PreviewScene->InvalidateCapture();
 }
 
 void SViewportWidget::SetViewportLightBrightness(float brightness)
 {
+	if (!PreviewScene.IsValid())
+	{
+		PendingLightBrightness = brightness;
+		return;
+	}
+
+	if (PreviewScene->GetLightBrightness() == brightness)
+	{
+		return;
+	}
+
 	PreviewScene->SetLightBrightness(brightness);
+	RequestRedraw();
 }
 
 void SViewportWidget::SetViewportLightDirection(FRotator& InLightDir)
 {
-	PreviewScene->SetLightDirection(InLightDir);
-}
+	if (!PreviewScene.IsValid())
+	{
+		PendingLightDirection = InLightDir;
+		return;
+	}
 
-void SViewportWidget::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
-{
-	SceneViewport->Invalidate();
-	SceneViewport->Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
+	if (PreviewScene->GetLightDirection().Equals(InLightDir))
+	{
+		return;
+	}
 
-	Client->Tick(InDeltaTime);
+	PreviewScene->SetLightDirection(InLightDir);
+	RequestRedraw();
 }
 
-bool SViewportWidget::IsVisible() const
+void SViewportWidget::Prewarm()
 {
-	const float VisibilityTimeThreshold = .25f;
-	// The viewport is visible if we don't have a parent layout (likely a floating window) or this viewport is visible in the parent layout.
-	// Also, always render the viewport if DumpGPU is active, regardless of tick time threshold -- otherwise these don't show up due to lag
-	// caused by the GPU dump being triggered.
-	return true;
-		
+	EnsurePreviewScene();
 }
 
-TWeakObjectPtr<AActor> SViewportWidget::GetSpawnedActor(const int32 entryIndex) const
+void SViewportWidget::EnsurePreviewScene()
 {
-	if (Entries.IsSet())
+	if (PreviewScene.IsValid())
 	{
-		if (Entries.Get().IsValidIndex(entryIndex))
-		{
-			return Entries.Get()[entryIndex].ActorObjectPtr;
-		}
+		return;
 	}
 
-	return TWeakObjectPtr<AActor>();
-}
+	FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+	PreviewScene = bUsesSharedScene && module
+		? module->FindOrCreateSharedPreviewScene(SharedSceneName, WorldProfile)
+		: MakeShareable(new FCustomPreviewScene(WorldProfile));
 
+	Client->SetPreviewScene(PreviewScene.Get());
+	PreviewScene->SetMaxPooledActorsPerClass(EntryActorPoolSize);
 
-void SViewportWidget::CleanEntries()
-{
-	if (UWorld* world = PreviewScene ? PreviewScene->GetWorld() : nullptr)
+	if (PendingSkyBrightness.IsSet())
 	{
-		if (Entries.IsSet())
-		{
-			for (FViewportWidgetEntry& ViewportWidgetEntry : const_cast<TArray<FViewportWidgetEntry>&>(Entries.Get()))
-			{
-				if (AActor* actor = ViewportWidgetEntry.ActorObjectPtr.Get())
-				{
-					world->DestroyActor(actor);
-				}
+		PreviewScene->SetSkyBrightness(PendingSkyBrightness.GetValue());
+	}
 
-				ViewportWidgetEntry.ActorObjectPtr.Reset();
-			}
-		}
+	if (PendingLightBrightness.IsSet())
+	{
+		PreviewScene->SetLightBrightness(PendingLightBrightness.GetValue());
 	}
-}
 
-void SViewportWidget::AddEntries()
-{
-	if (UWorld* world = PreviewScene ? PreviewScene->GetWorld() : nullptr)
+	if (PendingLightDirection.IsSet())
 	{
-		if (Entries.IsSet())
-		{
-			for (FViewportWidgetEntry& ViewportWidgetEntry : const_cast<TArray<FViewportWidgetEntry>&>(Entries.Get()))
-			{
-				if (TSubclassOf<AActor> actorClass = ViewportWidgetEntry.ActorClassPtr.LoadSynchronous())
-				{
-					FActorSpawnParameters SpawnInfo;
-					SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-					SpawnInfo.bNoFail = true;
-					SpawnInfo.ObjectFlags = RF_Transient | RF_Transactional;
+		PreviewScene->SetLightDirection(PendingLightDirection.GetValue());
+	}
+
+	if (PendingCubemap.IsSet())
+	{
+		PreviewScene->RequestCapture(PendingCubemap->Get());
+	}
+	else if (bPendingCaptureRequest)
+	{
+		PreviewScene->RequestCapture();
+	}
 
-					AActor* actor = world->SpawnActor(actorClass, &ViewportWidgetEntry.SpawnTransform, SpawnInfo);
+	if (bPendingCaptureInvalidation)
+	{
+		PreviewScene->InvalidateCapture();
+	}
 
-					ViewportWidgetEntry.ActorObjectPtr = actor;
+	PendingSkyBrightness.Reset();
+	PendingLightBrightness.Reset();
+	PendingLightDirection.Reset();
+	PendingCubemap.Reset();
+	bPendingCaptureRequest = false;
+	bPendingCaptureInvalidation = false;
 
-					SetupSpawnedActor(actor, world);
-				}
-			}
-		}
+	if (bHasPendingEntries)
+	{
+		LoadPendingEntries();
 	}
-}
 
-//------------------------------------------------------
-// UViewportWidget
-//------------------------------------------------------
-UViewportWidget::UViewportWidget(const FObjectInitializer& ObjectInitializer)
-	: Super(ObjectInitializer)
-{
-	bIsVariable = true;
+	RequestRedraw();
 }
 
-void UViewportWidget::SynchronizeProperties()
+void SViewportWidget::SetRedrawMode(EViewportWidgetRedrawMode InRedrawMode)
 {
-	Super::SynchronizeProperties();
-
-	if (MyViewport.IsValid())
+	if (RedrawMode != InRedrawMode)
 	{
-		MyViewport->SetViewTransform(ViewTransform);
-		MyViewport->SetEntries(Entries);
-
-		FLinearColor linearColor = BackgroundColor.ReinterpretAsLinear();
-		MyViewport->SetViewportBackgroudColor(linearColor);
-		MyViewport->SetViewportFOV(FOV);
-		if (EnablePreviewLighting)
-		{
-			MyViewport->SetViewportSkyBrightness(SkyBrightness);
-			MyViewport->SetViewportLightBrightness(LightBrightness); 
-			MyViewport->SetViewportLightDirection(LightDirection);
-		}
-		else
-		{
-			MyViewport->UpdateCapture();
-			MyViewport->SetViewportSkyBrightness(0);
-			MyViewport->SetViewportLightBrightness(0);
-		}
+		RedrawMode = InRedrawMode;
+		RequestRedraw();
 	}
 }
 
-void UViewportWidget::ReleaseSlateResources(bool bReleaseChildren)
+void SViewportWidget::SetRealtimeForDuration(float Seconds)
 {
-	MyViewport.Reset();
+	RealtimeEndTime = FMath::Max(RealtimeEndTime, FSlateApplication::Get().GetCurrentTime() + Seconds);
+}
 
-	Super::ReleaseSlateResources(bReleaseChildren);
+void SViewportWidget::SetSnapshotFrameCount(int32 frameCount)
+{
+	SnapshotFrameCount = FMath::Max(frameCount, 1);
 }
 
-#if WITH_EDITOR
-const FText UViewportWidget::GetPaletteCategory()
+bool SViewportWidget::IsSnapshotFrozen() const
 {
-	return LOCTEXT("Advanced", "Advanced");
+	return RedrawMode == EViewportWidgetRedrawMode::Snapshot && !bRedrawRequested && SnapshotFramesRemaining == 0;
 }
-#endif
 
-void UViewportWidget::SetViewTransform(FTransform viewTransform)
+void SViewportWidget::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
 {
-	ViewTransform = viewTransform;
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_Tick);
+	CSV_SCOPED_TIMING_STAT(ViewportWidget, Tick);
 
-	if (MyViewport.IsValid())
+	LastTickTime = InCurrentTime;
+
+	SceneViewport->Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
+
+	// Reads complete whether or not the viewport renders again
+	if (FrameReadback.IsValid())
 	{
-		MyViewport->SetViewTransform(ViewTransform);
+		UTextureRenderTarget2D* batchRenderTarget = nullptr;
+		FIntRect batchRect;
+		if (GetBatchedViewTarget(batchRenderTarget, batchRect))
+		{
+			FrameReadback->Update(*batchRenderTarget->GameThread_GetRenderTargetResource(), batchRect);
+		}
+		else
+		{
+			FrameReadback->Update(*SceneViewport);
+		}
 	}
-}
 
-void UViewportWidget::SetEntries(const TArray<FViewportWidgetEntry>& entries)
-{
-	Entries = entries;
+	UpdateBatchedViewBrush();
 
-	if (MyViewport.IsValid())
+	// Nothing is spawned yet, the cached image is all there is to show
+	if (bShowingCachedThumbnail)
 	{
-		MyViewport->SetEntries(Entries);
+		return;
 	}
-}
 
-AActor* UViewportWidget::GetSpawnedActor(const int32 entryIndex) const
-{
-	if (MyViewport.IsValid())
+	const bool bWasOnScreen = bIsOnScreen;
+	UpdateVisibility(AllottedGeometry, InCurrentTime);
+
+	// Neither the preview world nor the scene is worth updating while nobody can see them
+	if (!bIsOnScreen)
 	{
-		return MyViewport->GetSpawnedActor(entryIndex).IsValid() ? MyViewport->GetSpawnedActor(entryIndex).Get() : nullptr;
+		return;
 	}
 
-	return nullptr;
-}
+	if (!bWasOnScreen)
+	{
+		RequestRedraw();
+	}
 
+	// A mirrored world belongs to the game, which ticks it and owns its lighting
+	if (!IsMirroringWorld())
+	{
+		EnsurePreviewScene();
+	}
 
-TSharedRef<SWidget> UViewportWidget::RebuildWidget()
-{
-	MyViewport = SNew(SViewportWidget)
-		.ViewTransform(ViewTransform)
-		.Entries(Entries);
+	UpdateTextureStreaming(InCurrentTime);
 
-	if (GetChildrenCount() > 0)
+	// Captures belong to the scene, whichever of its viewports makes one, all of them have to redraw
+	if (PreviewScene.IsValid())
 	{
-		MyViewport->SetContent(GetContentSlot()->Content ? GetContentSlot()->Content->TakeWidget() : SNullWidget::NullWidget);
+		PreviewScene->UpdatePendingCapture();
+		if (PreviewScene->GetCaptureGeneration() != LastCaptureGeneration)
+		{
+			LastCaptureGeneration = PreviewScene->GetCaptureGeneration();
+			RequestRedraw();
+		}
 	}
 
-	return MyViewport.ToSharedRef();
-}
+	// A world paused while static only ticks on frames that render, so the redraw check has to come first.
+	// A frozen snapshot always pauses its world
+	const bool bPauseWhenStatic = TickPolicy.bPauseWhenStatic || RedrawMode == EViewportWidgetRedrawMode::Snapshot;
 
-//------------------------------------------------------
-// FCustomViewportClient
-//------------------------------------------------------
-
-/** Parameter struct for editor viewport view modifiers */
-struct FCustomViewportViewModifierParams
-{
-	FMinimalViewInfo ViewInfo;
+	bool bRedraw = bPauseWhenStatic && ShouldRedraw(InCurrentTime);
+	if (!bPauseWhenStatic || bRedraw)
+	{
+		TickPreviewWorld(InDeltaTime);
+	}
 
-	void AddPostProcessBlend(const FPostProcessSettings& Settings, float Weight)
+	if (!bPauseWhenStatic)
 	{
-		check(PostProcessSettings.Num() == PostProcessBlendWeights.Num());
-		PostProcessSettings.Add(Settings);
-		PostProcessBlendWeights.Add(Weight);
+		bRedraw = ShouldRedraw(InCurrentTime);
 	}
 
-private:
-	TArray<FPostProcessSettings> PostProcessSettings;
-	TArray<float> PostProcessBlendWeights;
+	// Invalidate draws the scene right away through the client, so skipping it keeps the last frame in the render target
+	if (bRedraw)
+	{
+		FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+		if (!module || module->GetRenderScheduler().RequestRender(this, IsHighRenderPriority()))
+		{
+			// A change restarts the snapshot warmup, this frame being the first of it
+			SnapshotFramesRemaining = bRedrawRequested ? SnapshotFrameCount - 1 : FMath::Max(SnapshotFramesRemaining - 1, 0);
+			bRedrawRequested = false;
+			LastRenderedSize = SceneViewport->GetSizeXY();
 
-	friend class FCustomViewportClient;
-};
+			if (bUsesSharedScene || IsMirroringWorld())
+			{
+				UpdateShowOnlyPrimitives();
+			}
 
-static int32 ViewOptionIndex = 0;
-static TArray<ECustomViewportType> ViewOptions;
+			UpdateResolutionFraction();
 
-void InitViewOptionsArray()
-{
-	ViewOptions.Empty();
+			INC_DWORD_STAT(STAT_ViewportWidget_NumRenders);
+			CSV_CUSTOM_STAT(ViewportWidget, Renders, 1, ECsvCustomStatOp::Accumulate);
 
-	ECustomViewportType Front = ECustomViewportType::CVT_OrthoXZ;
-	ECustomViewportType Back = ECustomViewportType::CVT_OrthoNegativeXZ;
-	ECustomViewportType Top = ECustomViewportType::CVT_OrthoXY;
-	ECustomViewportType Bottom = ECustomViewportType::CVT_OrthoNegativeXY;
-	ECustomViewportType Left = ECustomViewportType::CVT_OrthoYZ;
-	ECustomViewportType Right = ECustomViewportType::CVT_OrthoNegativeYZ;
+			if (ShouldBatchView())
+			{
+				module->GetViewBatcher().AddView(this, PreviewScene.ToSharedRef(), SceneViewport->GetSizeXY());
+			}
+			else
+			{
+				SceneViewport->Invalidate();
+			}
 
-	ViewOptions.Add(Front);
-	ViewOptions.Add(Back);
-	ViewOptions.Add(Top);
-	ViewOptions.Add(Bottom);
-	ViewOptions.Add(Left);
-	ViewOptions.Add(Right);
+			if (CachedThumbnailTexture.IsValid() && !bHasPendingEntries)
+			{
+				CachedThumbnailBrush.SetResourceObject(nullptr);
+				CachedThumbnailTexture.Reset();
+			}
+		}
+		else
+		{
+			// Over budget this frame, keep the change so it is rendered when the scheduler gets to us
+			bRedrawRequested = true;
+		}
+	}
+	else if (ThumbnailCacheKey != 0 && !bThumbnailCaptured && !bHasPendingEntries && Entries.IsSet())
+	{
+		// Nothing changed since the last render, so the frame in the render target is the settled image
+		CaptureThumbnail();
+	}
 }
 
-const EViewModeIndex FCustomViewportClient::DefaultPerspectiveViewMode = VMI_Lit;
-const EViewModeIndex FCustomViewportClient::DefaultOrthoViewMode = VMI_BrushWireframe;
-
-float ComputeOrthoZoomFactor(const float ViewportWidth)
+void SViewportWidget::SetThumbnailCacheKey(uint64 key)
 {
-	float Ret = 1.0f;
+	if (ThumbnailCacheKey == key)
+	{
+		return;
+	}
 
-	// We want to have all ortho view ports scale the same way to have the axis aligned with each other.
-	// So we take out the usual scaling of a view based on it's width.
-	// That means when a view port is resized in x or y it shows more content, not the same content larger (for x) or has no effect (for y).
-	// 500 is to get good results with existing view port settings.
-	Ret = ViewportWidth / 500.0f;
+	ThumbnailCacheKey = key;
+	bThumbnailCaptured = false;
 
-	return Ret;
-}
+	if (UpdateDepth > 0)
+	{
+		bThumbnailCacheKeyChangedInUpdate = true;
+		return;
+	}
 
-namespace OrbitConstants_NM
-{
-	const float OrbitPanSpeed = 1.0f;
-	const float IntialLookAtDistance = 1024.f;
+	RefreshCachedThumbnail();
 }
 
-namespace CustomViewportDefs_NM
+void SViewportWidget::RefreshCachedThumbnail()
 {
-	/** Default camera field of view angle for level editor perspective viewports */
-	const float DefaultPerspectiveFOVAngle(90.0f);
+	if (bShowingCachedThumbnail && (ThumbnailCacheKey == 0 || !LoadCachedThumbnail()))
+	{
+		WakeFromCachedThumbnail();
+	}
 }
 
-FCustomUMGViewportClient::FCustomUMGViewportClient(FPreviewScene* InPreviewScene)
+bool SViewportWidget::LoadCachedThumbnail()
 {
-	PreviewScene = InPreviewScene;
-}
+	FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+	if (!module)
+	{
+		return false;
+	}
 
-FCustomUMGViewportClient::~FCustomUMGViewportClient()
-{
-}
+	FIntPoint size;
+	TArray<FColor> pixels;
+	if (!module->GetThumbnailCache().Find(ThumbnailCacheKey, size, pixels))
+	{
+		return false;
+	}
 
-FCustomViewportClient::FCustomViewportClient(FPreviewScene* InPreviewScene, const TWeakPtr<SViewportWidget>& InViewportWidget)
-	: ImmersiveDelegate()
-	, VisibilityDelegate()
-	, Viewport(NULL)
-	, ViewportType(ECustomViewportType::CVT_Perspective)
-	, ViewState()
-	, StereoViewStates()
-	, EngineShowFlags(ESFIM_Editor)
-	, LastEngineShowFlags(ESFIM_Game)
-	, ExposureSettings()
-	, CurrentBufferVisualizationMode(NAME_None)
-	, CurrentNaniteVisualizationMode(NAME_None)
-	, CurrentLumenVisualizationMode(NAME_None)
-	, CurrentGroomVisualizationMode(NAME_None)
-	, CurrentVirtualShadowMapVisualizationMode(NAME_None)
-	, CurrentRayTracingDebugVisualizationMode(NAME_None)
-	, CurrentGPUSkinCacheVisualizationMode(NAME_None)
-	, ViewFOV(CustomViewportDefs_NM::DefaultPerspectiveFOVAngle)
-	, FOVAngle(CustomViewportDefs_NM::DefaultPerspectiveFOVAngle)
-	, bForcingUnlitForNewMap(false)
-	, bNeedsRedraw(true)
-	, LandscapeLODOverride(-1)
-	, TimeForForceRedraw(0.0)
-	, CurrentMousePos(-1, -1)
-	, bIsRealtime(true)
-	, PreviewScene(InPreviewScene)
-	, PerspViewModeIndex(DefaultPerspectiveViewMode)
-	, OrthoViewModeIndex(DefaultOrthoViewMode)
-	, ViewModeParam(-1)
-	, NearPlane(-1.0f)
-	, FarPlane(0.0f)
-	, bInGameViewMode(false)
-{
-	InitViewOptionsArray();
+	UTexture2D* texture = UTexture2D::CreateTransient(size.X, size.Y, PF_B8G8R8A8);
+	if (!texture)
+	{
+		return false;
+	}
 
-	FSceneInterface* Scene = GetScene();
 #if ENGINE_MAJOR_VERSION >= 5
-	ViewState.Allocate(Scene ? Scene->GetFeatureLevel() : GMaxRHIFeatureLevel);
+	FTexture2DMipMap& mip = texture->GetPlatformData()->Mips[0];
 #else
-	ViewState.Allocate();
+	FTexture2DMipMap& mip = texture->PlatformData->Mips[0];
 #endif
-	// NOTE: StereoViewState will be allocated on demand, for viewports than end up drawing in stereo
+	FMemory::Memcpy(mip.BulkData.Lock(LOCK_READ_WRITE), pixels.GetData(), pixels.Num() * sizeof(FColor));
+	mip.BulkData.Unlock();
+	texture->UpdateResource();
 
-	// Most editor viewports do not want motion blur.
-	EngineShowFlags.MotionBlur = 0;
+	CachedThumbnailTexture.Reset(texture);
+	CachedThumbnailBrush.SetResourceObject(texture);
+	CachedThumbnailBrush.ImageSize = FVector2D(size.X, size.Y);
 
-	EngineShowFlags.SetSnap(1);
+	return true;
+}
 
-	SetViewMode(IsPerspective() ? PerspViewModeIndex : OrthoViewModeIndex);
+void SViewportWidget::WakeFromCachedThumbnail()
+{
+	bShowingCachedThumbnail = false;
+	bAwaitingInteraction = false;
 
-	RequestUpdateDPIScale();
+	EnsurePreviewScene();
 
-#if WITH_EDITOR
-	FSlateApplication::Get().OnWindowDPIScaleChanged().AddRaw(this, &FCustomViewportClient::HandleWindowDPIScaleChanged);
-#endif
+	// The cached image stays on top until the live scene has rendered
+	if (bHasPendingEntries)
+	{
+		LoadPendingEntries();
+	}
+
+	RequestRedraw();
 }
 
-FCustomViewportClient::~FCustomViewportClient()
+void SViewportWidget::CaptureThumbnail()
 {
-	if (Viewport)
+	bThumbnailCaptured = true;
+
+	FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+	const FIntPoint size = SceneViewport->GetSizeXY();
+	if (!module || size.X <= 0 || size.Y <= 0)
 	{
-		UE_LOG(LogTemp, Fatal, TEXT("Viewport != NULL in FCustomViewportClient destructor."));
+		return;
 	}
 
-	if (FSlateApplication::IsInitialized())
+	// The key may change before the read completes, the image belongs to the one it was rendered for
+	const uint64 thumbnailCacheKey = ThumbnailCacheKey;
+	RequestFrameReadback(FOnViewportFrameRead::CreateLambda([thumbnailCacheKey](FIntPoint pixelsSize, const TArray<FColor>& pixels)
 	{
-#if WITH_EDITOR
-		FSlateApplication::Get().OnWindowDPIScaleChanged().RemoveAll(this);
-#endif
-	}
+		FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+		if (module && pixels.Num() > 0)
+		{
+			module->GetThumbnailCache().Store(thumbnailCacheKey, pixelsSize, pixels);
+		}
+	}));
 }
 
-bool FCustomViewportClient::ToggleRealtime()
+void SViewportWidget::SetBatchViews(bool bInBatchViews)
 {
-	SetRealtime(!bIsRealtime);
-	return bIsRealtime;
+	if (bBatchViews == bInBatchViews)
+	{
+		return;
+	}
+
+	bBatchViews = bInBatchViews;
+	RequestRedraw();
+
+	FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+	if (!bBatchViews && module)
+	{
+		module->GetViewBatcher().RemoveViewport(this);
+	}
 }
 
-float FCustomViewportClient::GetOrthoUnitsPerPixel(const FViewport* InViewport) const
+bool SViewportWidget::ShouldBatchView() const
 {
-	const float SizeX = static_cast<float>(InViewport->GetSizeXY().X);
+	return bBatchViews && bUsesSharedScene && !IsMirroringWorld() && PreviewScene.IsValid() && FViewportWidgetModule::GetPtr();
+}
 
-	// 15.0f was coming from the CAMERA_ZOOM_DIV marco, seems it was chosen arbitrarily
-	return (1 / (SizeX * 15.f)) * ComputeOrthoZoomFactor(SizeX);
+bool SViewportWidget::GetBatchedViewTarget(UTextureRenderTarget2D*& OutRenderTarget, FIntRect& OutRect) const
+{
+	FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+	return module && ShouldBatchView() && module->GetViewBatcher().GetViewTarget(this, OutRenderTarget, OutRect);
 }
 
-void FCustomViewportClient::SetInitialViewTransform(ECustomViewportType InViewportType, const FVector& ViewLocation, const FRotator& ViewRotation)
+void SViewportWidget::UpdateBatchedViewBrush()
 {
-	FCustomViewportCameraTransform& ViewTransform = (InViewportType == ECustomViewportType::CVT_Perspective) ? ViewTransformPerspective : ViewTransformOrthographic;
+	UTextureRenderTarget2D* renderTarget = nullptr;
+	FIntRect rect;
+	if (!GetBatchedViewTarget(renderTarget, rect))
+	{
+		// Back to the scene viewport, which has not rendered since the view was batched, or the batch dropped the view
+		if (BatchedViewBrush.GetResourceObject())
+		{
+			FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+			if (!ShouldBatchView() && module)
+			{
+				module->GetViewBatcher().RemoveViewport(this);
+			}
 
-	ViewTransform.SetLocation(ViewLocation);
-	ViewTransform.SetRotation(ViewRotation);
+			BatchedViewBrush.SetResourceObject(nullptr);
+			RequestRedraw();
+		}
 
-	// Make a look at location in front of the camera
-	const FQuat CameraOrientation = FQuat::MakeFromEuler(ViewRotation.Euler());
-	FVector Direction = CameraOrientation.RotateVector(FVector(1, 0, 0));
+		return;
+	}
 
-	ViewTransform.SetLookAt(ViewLocation + Direction * OrbitConstants_NM::IntialLookAtDistance);
-}
+	const FVector2D atlasSize(renderTarget->SizeX, renderTarget->SizeY);
 
-//////////////////////////////////////////////////////////////////////////
-//
-// Configures the specified FSceneView object with the view and projection matrices for this viewport.
+	BatchedViewBrush.SetResourceObject(renderTarget);
+	BatchedViewBrush.ImageSize = FVector2D(rect.Width(), rect.Height());
+	BatchedViewBrush.SetUVRegion(FBox2D(FVector2D(rect.Min.X, rect.Min.Y) / atlasSize, FVector2D(rect.Max.X, rect.Max.Y) / atlasSize));
+}
 
-FSceneView* FCustomViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily, const int32 StereoViewIndex)
+void SViewportWidget::RequestFrameReadback(const FOnViewportFrameRead& OnRead)
 {
-	const bool bStereoRendering = StereoViewIndex != INDEX_NONE;
+	if (!FrameReadback.IsValid())
+	{
+		FrameReadback = MakeUnique<FViewportFrameReadback>();
+	}
 
-	FSceneViewInitOptions ViewInitOptions;
+	FrameReadback->Request(OnRead);
+}
 
-	FCustomViewportCameraTransform& ViewTransform = GetViewTransform();
-	const ECustomViewportType EffectiveViewportType = GetViewportType();
+void SViewportWidget::TickPreviewWorld(float InDeltaTime)
+{
+	// A world shared by several viewports is ticked by the first visible one, a mirrored world by the game
+	if (IsMirroringWorld() || !PreviewScene.IsValid() || !PreviewScene->TryClaimFrameTick())
+	{
+		return;
+	}
 
-	// Apply view modifiers.
-	FCustomViewportViewModifierParams ViewModifierParams;
+	float deltaTime = InDeltaTime;
+	if (TickPolicy.TickRate > 0.f)
 	{
-		ViewModifierParams.ViewInfo.Location = ViewTransform.GetLocation();
-		ViewModifierParams.ViewInfo.Rotation = ViewTransform.GetRotation();
+		const float tickInterval = 1.f / TickPolicy.TickRate;
 
-		ViewModifierParams.ViewInfo.FOV = ViewFOV;
+		TickAccumulator += InDeltaTime;
+		if (TickAccumulator < tickInterval)
+		{
+			return;
+		}
+
+		// A single world tick covers all the elapsed steps so a slow frame never queues several ticks
+		deltaTime = FMath::FloorToFloat(TickAccumulator / tickInterval) * tickInterval;
+		TickAccumulator -= deltaTime;
 	}
-	const FVector ModifiedViewLocation = ViewModifierParams.ViewInfo.Location;
-	FRotator ModifiedViewRotation = ViewModifierParams.ViewInfo.Rotation;
-	const float ModifiedViewFOV = ViewModifierParams.ViewInfo.FOV;
 
-	ViewInitOptions.ViewOrigin = ModifiedViewLocation;
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_WorldTick);
+	CSV_SCOPED_TIMING_STAT(ViewportWidget, WorldTick);
 
-	FIntPoint ViewportSize = Viewport->GetSizeXY();
-	ViewportSize.X = FMath::Max(ViewportSize.X, 1);
-	ViewportSize.Y = FMath::Max(ViewportSize.Y, 1);
-	FIntPoint ViewportOffset(0, 0);
-	ViewInitOptions.SetViewRectangle(FIntRect(ViewportOffset, ViewportOffset + ViewportSize));
+	Client->SetLevelTick(TickPolicy.bTimeOnly ? LEVELTICK_TimeOnly : LEVELTICK_All);
+	Client->Tick(deltaTime);
+}
 
-	ViewInitOptions.ViewRotationMatrix = FInverseRotationMatrix(ViewModifierParams.ViewInfo.Rotation);
-	ViewInitOptions.ViewRotationMatrix = ViewInitOptions.ViewRotationMatrix * FMatrix(
-		FPlane(0, 0, 1, 0),
-		FPlane(1, 0, 0, 0),
-		FPlane(0, 1, 0, 0),
-		FPlane(0, 0, 0, 1));
+void SViewportWidget::SetResolutionSettings(const FViewportWidgetResolutionSettings& InResolutionSettings)
+{
+	if (ResolutionSettings == InResolutionSettings)
+	{
+		return;
+	}
 
-	EAspectRatioAxisConstraint AspectRatioAxisConstraint = EAspectRatioAxisConstraint::AspectRatio_MajorAxisFOV;
-	FMinimalViewInfo::CalculateProjectionMatrixGivenView(ViewModifierParams.ViewInfo, AspectRatioAxisConstraint, Viewport, /*inout*/ ViewInitOptions);
+	ResolutionSettings = InResolutionSettings;
 
+	Client->SetMeasureGPUTime(ResolutionSettings.bAdaptive);
+	if (!ResolutionSettings.bAdaptive)
 	{
-		//
-		if (EffectiveViewportType == ECustomViewportType::CVT_Perspective)
-		{
-			// Calc view rotation matrix
-			ViewInitOptions.ViewRotationMatrix = CalcViewRotationMatrix(ModifiedViewRotation);
-
-			// Rotate view 90 degrees
-			ViewInitOptions.ViewRotationMatrix = ViewInitOptions.ViewRotationMatrix * FMatrix(
-				FPlane(0, 0, 1, 0),
-				FPlane(1, 0, 0, 0),
-				FPlane(0, 1, 0, 0),
-				FPlane(0, 0, 0, 1));
+		Client->SetResolutionFraction(ResolutionSettings.MaxResolutionFraction);
+	}
 
-			{
-				const float MinZ = GetNearClipPlane();
-				const float MaxZ = MinZ;
-				// Avoid zero ViewFOV's which cause divide by zero's in projection matrix
-				const float MatrixFOV = FMath::Max(0.001f, ModifiedViewFOV) * (float)PI / 360.0f;
+	RequestRedraw();
+}
 
-				{
-					float XAxisMultiplier;
-					float YAxisMultiplier;
+void SViewportWidget::UpdateTextureStreaming(double InCurrentTime)
+{
+	if (!FCustomPreviewScene::UsesTextureStreaming())
+	{
+		return;
+	}
 
-					if (((ViewportSize.X > ViewportSize.Y) && (AspectRatioAxisConstraint == AspectRatio_MajorAxisFOV)) || (AspectRatioAxisConstraint == AspectRatio_MaintainXFOV))
-					{
-						//if the viewport is wider than it is tall
-						XAxisMultiplier = 1.0f;
-						YAxisMultiplier = ViewportSize.X / (float)ViewportSize.Y;
-					}
-					else
-					{
-						//if the viewport is taller than it is wide
-						XAxisMultiplier = ViewportSize.Y / (float)ViewportSize.X;
-						YAxisMultiplier = 1.0f;
-					}
+	const FIntPoint size = SceneViewport->GetSizeXY();
+	if (size.X <= 0 || size.Y <= 0)
+	{
+		return;
+	}
 
-					if ((bool)ERHIZBuffer::IsInverted)
-					{
-						ViewInitOptions.ProjectionMatrix = FReversedZPerspectiveMatrix(
-							MatrixFOV,
-							MatrixFOV,
-							XAxisMultiplier,
-							YAxisMultiplier,
-							MinZ,
-							MaxZ
-						);
-					}
-					else
-					{
-						ViewInitOptions.ProjectionMatrix = FPerspectiveMatrix(
-							MatrixFOV,
-							MatrixFOV,
-							XAxisMultiplier,
-							YAxisMultiplier,
-							MinZ,
-							MaxZ
-						);
-					}
-				}
-			}
-		}
-		else
-		{
-			static_assert((bool)ERHIZBuffer::IsInverted, "Check all the Rotation Matrix transformations!");
-			float ZScale = 0.5f / WORLD_MAX;	// LWC_TODO: WORLD_MAX misuse?
-			float ZOffset = WORLD_MAX;
+	// Like a game view, the view asks for the mips its textures need at the size it is actually rendered at
+	float screenSize = FMath::Max(size.X, size.Y) * Client->GetResolutionFraction();
 
-			//The divisor for the matrix needs to match the translation code.
-			const float Zoom = GetOrthoUnitsPerPixel(Viewport);
+	const int32 maxScreenSize = CVarViewportWidgetTextureStreamingMaxScreenSize.GetValueOnGameThread();
+	if (maxScreenSize > 0)
+	{
+		screenSize = FMath::Min(screenSize, (float)maxScreenSize);
+	}
 
-			float OrthoWidth = Zoom * ViewportSize.X / 2.0f;
-			float OrthoHeight = Zoom * ViewportSize.Y / 2.0f;
+	const float halfFOV = FMath::DegreesToRadians(FMath::Clamp(Client->GetViewFOV(), 1.f, 179.f) * .5f);
+	const float fovScreenSize = screenSize / FMath::Tan(halfFOV);
 
-			if (EffectiveViewportType == ECustomViewportType::CVT_OrthoXY)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(1, 0, 0, 0),
-					FPlane(0, -1, 0, 0),
-					FPlane(0, 0, -1, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoXZ)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(1, 0, 0, 0),
-					FPlane(0, 0, -1, 0),
-					FPlane(0, 1, 0, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoYZ)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(0, 0, 1, 0),
-					FPlane(1, 0, 0, 0),
-					FPlane(0, 1, 0, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoNegativeXY)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(-1, 0, 0, 0),
-					FPlane(0, -1, 0, 0),
-					FPlane(0, 0, 1, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoNegativeXZ)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(-1, 0, 0, 0),
-					FPlane(0, 0, 1, 0),
-					FPlane(0, 1, 0, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoNegativeYZ)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(0, 0, -1, 0),
-					FPlane(-1, 0, 0, 0),
-					FPlane(0, 1, 0, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoFreelook)
-			{
-				ViewInitOptions.ViewRotationMatrix = FMatrix(
-					FPlane(0, 0, 1, 0),
-					FPlane(1, 0, 0, 0),
-					FPlane(0, 1, 0, 0),
-					FPlane(0, 0, 0, 1));
-			}
-			else
-			{
-				// Unknown viewport type
-				check(false);
-			}
+	IStreamingManager& streamingManager = IStreamingManager::Get();
+	streamingManager.AddViewInformation(Client->GetViewLocation(), screenSize, fovScreenSize, CVarViewportWidgetTextureStreamingBoost.GetValueOnGameThread());
 
-			ViewInitOptions.ProjectionMatrix = FReversedZOrthoMatrix(
-				OrthoWidth,
-				OrthoHeight,
-				ZScale,
-				ZOffset
-			);
-		}
+	if (bRedrawRequested)
+	{
+		TextureStreamingEndTime = InCurrentTime + TextureStreamingSettleTime;
 	}
 
-	if (!ViewInitOptions.IsValidViewRectangle())
+	// Mips streamed in after the last render only show on the next one, which an on demand viewport has no other reason to make
+	const int32 numWantingResources = streamingManager.GetNumWantingResources();
+	if (numWantingResources < LastNumWantingStreamingResources && InCurrentTime < TextureStreamingEndTime)
 	{
-		// Zero sized rects are invalid, so fake to 1x1 to avoid asserts later on
-		ViewInitOptions.SetViewRectangle(FIntRect(0, 0, 1, 1));
+		RequestRedraw();
 	}
 
-	ViewInitOptions.ViewFamily = ViewFamily;
-	ViewInitOptions.SceneViewStateInterface = ViewState.GetReference();
-
-	ViewInitOptions.BackgroundColor = GetBackgroundColor();
-
-	ViewInitOptions.FOV = ModifiedViewFOV;
+	LastNumWantingStreamingResources = numWantingResources;
+}
 
-	ViewInitOptions.OverrideFarClippingPlaneDistance = FarPlane;
-	ViewInitOptions.CursorPos = CurrentMousePos;
+void SViewportWidget::UpdateResolutionFraction()
+{
+	float maxFraction = ResolutionSettings.MaxResolutionFraction;
 
-	FSceneView* View = new FSceneView(ViewInitOptions);
+	if (ResolutionSettings.bCapAtLogicalResolution)
+	{
+		maxFraction = FMath::Min(maxFraction, 1.f / FMath::Max(Client->GetDPIScale(), 1.f));
+	}
 
-	View->ViewLocation = ModifiedViewLocation;
-	View->ViewRotation = ModifiedViewRotation;
+	const FIntPoint size = SceneViewport->GetSizeXY();
+	if (ResolutionSettings.MaxRenderSize > 0 && FMath::Max(size.X, size.Y) > 0)
+	{
+		maxFraction = FMath::Min(maxFraction, ResolutionSettings.MaxRenderSize / (float)FMath::Max(size.X, size.Y));
+	}
 
-	int32 FamilyIndex = ViewFamily->Views.Add(View);
-	//check(FamilyIndex == View->StereoViewIndex || View->StereoViewIndex == INDEX_NONE);
+	float fraction = Client->GetResolutionFraction();
 
-	View->StartFinalPostprocessSettings(View->ViewLocation);
+	float gpuTimeMs = 0.f;
+	if (ResolutionSettings.bAdaptive && Client->ConsumeGPUTime(gpuTimeMs))
+	{
+		// GPU time grows with the pixel count, so the fraction that meets the target scales with the square root of the ratio.
+		// Within 80% to 100% of the target nothing changes, to avoid oscillating around it
+		const float targetTimeMs = ResolutionSettings.TargetGPUTimeMs;
+		if (gpuTimeMs > targetTimeMs || gpuTimeMs < targetTimeMs * .8f)
+		{
+			const float idealFraction = fraction * FMath::Sqrt(targetTimeMs * .9f / FMath::Max(gpuTimeMs, .01f));
+			fraction = FMath::Lerp(fraction, idealFraction, .5f);
+		}
+	}
+	else if (!ResolutionSettings.bAdaptive)
+	{
+		fraction = maxFraction;
+	}
 
-	OverridePostProcessSettings(*View);
+	const float minFraction = FMath::Min(ResolutionSettings.bAdaptive ? ResolutionSettings.MinResolutionFraction : maxFraction, maxFraction);
+	Client->SetResolutionFraction(FMath::Clamp(fraction, minFraction, maxFraction));
+}
 
-	if (ViewModifierParams.ViewInfo.PostProcessBlendWeight > 0.f)
+void SViewportWidget::SetQualityProfile(FName profileName)
+{
+	if (QualityProfileName == profileName)
 	{
-		View->OverridePostProcessSettings(ViewModifierParams.ViewInfo.PostProcessSettings, ViewModifierParams.ViewInfo.PostProcessBlendWeight);
+		return;
 	}
-	const int32 PPNum = FMath::Min(ViewModifierParams.PostProcessSettings.Num(), ViewModifierParams.PostProcessBlendWeights.Num());
-	for (int32 PPIndex = 0; PPIndex < PPNum; ++PPIndex)
+
+	QualityProfileName = profileName;
+	Client->SetQualityProfile(UViewportWidgetSettings::FindQualityProfile(profileName));
+	RequestRedraw();
+}
+
+void SViewportWidget::SetTickPolicy(const FViewportWidgetTickPolicy& InTickPolicy)
+{
+	TickPolicy = InTickPolicy;
+
+	if (TickPolicy.TickRate <= 0.f)
 	{
-		const FPostProcessSettings& PPSettings = ViewModifierParams.PostProcessSettings[PPIndex];
-		const float PPWeight = ViewModifierParams.PostProcessBlendWeights[PPIndex];
-		View->OverridePostProcessSettings(PPSettings, PPWeight);
+		TickAccumulator = 0.f;
 	}
+}
 
-	View->EndFinalPostprocessSettings(ViewInitOptions);
+bool SViewportWidget::IsHighRenderPriority() const
+{
+	return IsHovered() || HasAnyUserFocusOrFocusedDescendants();
+}
 
-	for (int ViewExt = 0; ViewExt < ViewFamily->ViewExtensions.Num(); ViewExt++)
+bool SViewportWidget::ShouldRedraw(const double InCurrentTime)
+{
+	// Always evaluated so the cached transforms stay current whatever the mode
+	const bool bEntryActorsChanged = HaveEntryActorsChanged();
+
+	// A snapshot ignores animation, only explicit changes and its warmup frames render
+	if (RedrawMode == EViewportWidgetRedrawMode::Snapshot)
 	{
-		ViewFamily->ViewExtensions[ViewExt]->SetupView(*ViewFamily, *View);
+		return bRedrawRequested
+			|| SnapshotFramesRemaining > 0
+			|| InCurrentTime < RealtimeEndTime
+			|| SceneViewport->GetSizeXY() != LastRenderedSize;
 	}
 
-	return View;
+	return RedrawMode == EViewportWidgetRedrawMode::Realtime
+		|| bRedrawRequested
+		|| bEntryActorsChanged
+		|| InCurrentTime < RealtimeEndTime
+		|| SceneViewport->GetSizeXY() != LastRenderedSize;
 }
 
-void FCustomViewportClient::Tick(float DeltaTime)
+bool SViewportWidget::HaveEntryActorsChanged()
 {
-	if (!GIntraFrameDebuggingGameThread)
+	bool bChanged = false;
+
+	TArray<const AActor*> actors;
+	GetDisplayedActors(actors);
+	LastEntryActorTransforms.SetNum(actors.Num());
+
+	for (int32 i = 0; i < actors.Num(); i++)
 	{
-		// Begin Play
-		UWorld* PreviewWorld = PreviewScene->GetWorld();
-		if (!PreviewWorld->bBegunPlay)
+		if (const AActor* actor = actors[i])
 		{
-			for (FActorIterator It(PreviewWorld); It; ++It)
+			const FTransform& actorTransform = actor->GetActorTransform();
+			if (!LastEntryActorTransforms[i].Equals(actorTransform))
 			{
-				It->DispatchBeginPlay();
+				LastEntryActorTransforms[i] = actorTransform;
+				bChanged = true;
 			}
-			PreviewWorld->bBegunPlay = true;
+
+			bChanged |= IsActorAnimating(actor);
 		}
+	}
 
-		// Tick
-		PreviewWorld->Tick(LEVELTICK_All, DeltaTime);
+	return bChanged;
+}
+
+int32 SViewportWidget::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	LastCullingRect = MyCullingRect;
+
+	// A batched view is shown by the stand-in image, the scene viewport only holds a frame from before the view was batched.
+	// It is still told about the paint, which is where it follows the widget's size
+	if (BatchedViewBrush.GetResourceObject())
+	{
+		const int32 maxLayerId = SCompoundWidget::OnPaint(Args, AllottedGeometry, MyCullingRect, OutDrawElements, LayerId, InWidgetStyle, bParentEnabled);
+		SceneViewport->OnDrawViewport(AllottedGeometry, MyCullingRect, OutDrawElements, LayerId, InWidgetStyle, bParentEnabled);
+
+		return maxLayerId;
 	}
+
+	return SViewport::OnPaint(Args, AllottedGeometry, MyCullingRect, OutDrawElements, LayerId, InWidgetStyle, bParentEnabled);
 }
 
-void FCustomViewportClient::SetViewportType(ECustomViewportType InViewportType)
+const FSlateBrush* SViewportWidget::GetStandInBrush() const
 {
-	ViewportType = InViewportType;
+	if (CachedThumbnailTexture.IsValid())
+	{
+		return &CachedThumbnailBrush;
+	}
 
-	// Changing the type may also change the active view mode; re-apply that now
-	ApplyViewMode(GetViewMode(), IsPerspective(), EngineShowFlags);
+	return BatchedViewBrush.GetResourceObject() ? &BatchedViewBrush : nullptr;
+}
 
-	// We might have changed to an orthographic viewport; if so, update any viewport links
-	UpdateLinkedOrthoViewports(true);
+void SViewportWidget::OnMouseEnter(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent)
+{
+	if (bShowingCachedThumbnail)
+	{
+		WakeFromCachedThumbnail();
+	}
 
-	Invalidate();
+	SViewport::OnMouseEnter(MyGeometry, MouseEvent);
 }
 
-void FCustomViewportClient::RotateViewportType()
+bool SViewportWidget::IsVisible() const
 {
-	ViewportType = ViewOptions[ViewOptionIndex];
+	// Slate stops ticking widgets it does not paint, so a stale tick means the viewport is no longer on screen.
+	return bIsOnScreen && (FSlateApplication::Get().GetCurrentTime() - LastTickTime) <= VisibilityTimeThreshold;
+}
 
-	// Changing the type may also change the active view mode; re-apply that now
-	ApplyViewMode(GetViewMode(), IsPerspective(), EngineShowFlags);
+void SViewportWidget::UpdateVisibility(const FGeometry& AllottedGeometry, const double InCurrentTime)
+{
+	bIsOnScreen = false;
 
-	// We might have changed to an orthographic viewport; if so, update any viewport links
-	UpdateLinkedOrthoViewports(true);
+	const FVector2D localSize = AllottedGeometry.GetLocalSize();
+	if (localSize.X <= 0 || localSize.Y <= 0)
+	{
+		return;
+	}
 
-	Invalidate();
+	// Scrolled out of a scroll box or otherwise clipped away by a parent
+	if (LastCullingRect.IsValid() && !FSlateRect::DoRectanglesIntersect(LastCullingRect, AllottedGeometry.GetLayoutBoundingRect()))
+	{
+		return;
+	}
 
-	if (ViewOptionIndex == 5)
+	TSharedPtr<SWidget> topWidget = AsShared();
+	for (TSharedPtr<SWidget> widget = topWidget; widget.IsValid(); widget = widget->GetParentWidget())
 	{
-		ViewOptionIndex = 0;
+		if (!widget->GetVisibility().IsVisible())
+		{
+			return;
+		}
+
+		topWidget = widget;
 	}
-	else
+
+	if (!CachedWindow.IsValid() || CachedWindow.Pin() != topWidget)
 	{
-		ViewOptionIndex++;
+		CachedWindow = topWidget->Advanced_IsWindow() ? StaticCastSharedPtr<SWindow>(topWidget) : FSlateApplication::Get().FindWidgetWindow(AsShared());
 	}
-}
 
-bool FCustomViewportClient::IsActiveViewportTypeInRotation() const { return GetViewportType() == ViewOptions[ViewOptionIndex]; }
+	if (TSharedPtr<SWindow> window = CachedWindow.Pin())
+	{
+		Client->SetWindowDPIScale(window->GetDPIScaleFactor());
+	}
 
-bool FCustomViewportClient::IsPerspective() const { return (GetViewportType() == ECustomViewportType::CVT_Perspective); }
-/**
- * Forcibly disables lighting show flags if there are no lights in the scene, or restores lighting show
- * flags if lights are added to the scene.
- */
-void FCustomViewportClient::UpdateLightingShowFlags(FEngineShowFlags& InOutShowFlags)
+	if (!Client->WantsDrawWhenAppIsHidden())
+	{
+		TSharedPtr<SWindow> window = CachedWindow.Pin();
+		if (!FSlateApplication::Get().IsActive() || (window.IsValid() && (window->IsWindowMinimized() || !window->IsVisible())))
+		{
+			return;
+		}
+	}
+
+	if (InCurrentTime - LastOcclusionCheckTime > VisibilityTimeThreshold)
+	{
+		LastOcclusionCheckTime = InCurrentTime;
+		bIsCovered = IsCoveredByOtherWidgets(AllottedGeometry);
+	}
+
+	bIsOnScreen = !bIsCovered;
+}
+
+bool SViewportWidget::IsCoveredByOtherWidgets(const FGeometry& AllottedGeometry) const
 {
-	bool bViewportNeedsRefresh = false;
+	// The hit test cannot tell a covered viewport from one that ignores hits, so those are never treated as covered
+	if (!GetVisibility().IsHitTestVisible())
+	{
+		return false;
+	}
 
-	if (bForcingUnlitForNewMap && !bInGameViewMode && IsPerspective())
+	TSharedPtr<SWidget> rootWidget;
+	for (TSharedPtr<SWidget> parent = GetParentWidget(); parent.IsValid(); parent = parent->GetParentWidget())
 	{
-		// We'll only use default lighting for viewports that are viewing the main world
-		if (GWorld != NULL && GetScene() != NULL && GetScene()->GetWorld() != NULL && GetScene()->GetWorld() == GWorld)
+		if (!parent->GetVisibility().AreChildrenHitTestVisible())
 		{
-			// Check to see if there are any lights in the scene
-			bool bAnyLights = GetScene()->HasAnyLights();
-			if (bAnyLights)
+			return false;
+		}
+
+		rootWidget = parent;
+	}
+
+	// A viewport drawn into a virtual window, e.g. by a widget renderer, is not on screen for the application's windows to cover
+	if (rootWidget.IsValid() && rootWidget->Advanced_IsWindow() && StaticCastSharedPtr<SWindow>(rootWidget)->IsVirtualWindow())
+	{
+		return false;
+	}
+
+	const FVector2D localSize = AllottedGeometry.GetLocalSize();
+	const FVector2D samplePoints[] = {
+		localSize * 0.5f,
+		localSize * FVector2D(0.1f, 0.1f),
+		localSize * FVector2D(0.9f, 0.1f),
+		localSize * FVector2D(0.1f, 0.9f),
+		localSize * FVector2D(0.9f, 0.9f),
+	};
+
+	const TArray<TSharedRef<SWindow>> windows = FSlateApplication::Get().GetInteractiveTopLevelWindows();
+	for (const FVector2D& samplePoint : samplePoints)
+	{
+		const FWidgetPath widgetPath = FSlateApplication::Get().LocateWindowUnderMouse(AllottedGeometry.LocalToAbsolute(samplePoint), windows, true);
+		if (!widgetPath.IsValid())
+		{
+			return false;
+		}
+
+		for (int32 i = 0; i < widgetPath.Widgets.Num(); i++)
+		{
+			if (&widgetPath.Widgets[i].Widget.Get() == this)
 			{
-				// Is unlit mode currently enabled?  We'll make sure that all of the regular unlit view
-				// mode show flags are set (not just EngineShowFlags.Lighting), so we don't disrupt other view modes
-				if (!InOutShowFlags.Lighting)
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+TWeakObjectPtr<AActor> SViewportWidget::GetSpawnedActor(const int32 entryIndex) const
+{
+	if (Entries.IsSet())
+	{
+		if (Entries.Get().IsValidIndex(entryIndex))
+		{
+			return Entries.Get()[entryIndex].ActorObjectPtr;
+		}
+	}
+
+	return TWeakObjectPtr<AActor>();
+}
+
+
+void SViewportWidget::CleanEntries()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_CleanEntries);
+	CSV_SCOPED_TIMING_STAT(ViewportWidget, CleanEntries);
+
+	if (UWorld* world = PreviewScene ? PreviewScene->GetWorld() : nullptr)
+	{
+		if (Entries.IsSet())
+		{
+			for (FViewportWidgetEntry& ViewportWidgetEntry : const_cast<TArray<FViewportWidgetEntry>&>(Entries.Get()))
+			{
+				if (AActor* actor = ViewportWidgetEntry.ActorObjectPtr.Get())
 				{
-					// We have lights in the scene now so go ahead and turn lighting back on
-					// designer can see what they're interacting with!
-					InOutShowFlags.SetLighting(true);
+					DestroyEntryActor(actor, world);
 				}
 
-				// No longer forcing lighting to be off
-				bForcingUnlitForNewMap = false;
+				ViewportWidgetEntry.ActorObjectPtr.Reset();
 			}
-			else
+		}
+	}
+}
+
+void SViewportWidget::ReconcileEntries(TArray<FViewportWidgetEntry>& newEntries)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_ReconcileEntries);
+	CSV_SCOPED_TIMING_STAT(ViewportWidget, ReconcileEntries);
+
+	UWorld* world = PreviewScene ? PreviewScene->GetWorld() : nullptr;
+	if (!world)
+	{
+		Entries = newEntries;
+		return;
+	}
+
+	const TArray<FViewportWidgetEntry>& oldEntries = Entries.IsSet() ? Entries.Get() : FViewportWidgetEntry::GetEmptyCollection();
+	const int32 numOldEntries = oldEntries.Num();
+
+	TArray<bool, TInlineAllocator<16>> oldEntryKept;
+	oldEntryKept.SetNumZeroed(numOldEntries);
+
+	TArray<bool, TInlineAllocator<16>> newEntryMatched;
+	newEntryMatched.SetNumZeroed(newEntries.Num());
+
+	// Old entry whose actor each new entry kept, INDEX_NONE for spawned ones
+	TArray<int32, TInlineAllocator<16>> newEntryOldIndex;
+	newEntryOldIndex.Init(INDEX_NONE, newEntries.Num());
+
+	const auto findOldEntry = [&](const FViewportWidgetEntry& newEntry, bool bSameTransform)
+	{
+		for (int32 i = 0; i < numOldEntries; i++)
+		{
+			if (!oldEntryKept[i] && oldEntries[i].ActorObjectPtr.IsValid() && oldEntries[i].ActorClassPtr == newEntry.ActorClassPtr
+				&& (!bSameTransform || oldEntries[i].SpawnTransform.Equals(newEntry.SpawnTransform)))
 			{
-				// Is lighting currently enabled?
-				if (InOutShowFlags.Lighting)
-				{
-					// No lights in the scene, so make sure that lighting is turned off so the level
-					// designer can see what they're interacting with!
-					InOutShowFlags.SetLighting(false);
-				}
+				return i;
+			}
+		}
+
+		return (int32)INDEX_NONE;
+	};
+
+	// Unchanged entries keep their actor as is
+	for (int32 i = 0; i < newEntries.Num(); i++)
+	{
+		const int32 oldIndex = findOldEntry(newEntries[i], true);
+		if (oldIndex != INDEX_NONE)
+		{
+			oldEntryKept[oldIndex] = true;
+			newEntryMatched[i] = true;
+			newEntryOldIndex[i] = oldIndex;
+			newEntries[i].ActorObjectPtr = oldEntries[oldIndex].ActorObjectPtr;
+		}
+	}
+
+	// Entries whose transform changed move their actor
+	for (int32 i = 0; i < newEntries.Num(); i++)
+	{
+		if (!newEntryMatched[i])
+		{
+			const int32 oldIndex = findOldEntry(newEntries[i], false);
+			if (oldIndex != INDEX_NONE)
+			{
+				oldEntryKept[oldIndex] = true;
+				newEntryMatched[i] = true;
+				newEntryOldIndex[i] = oldIndex;
+				newEntries[i].ActorObjectPtr = MoveEntryActor(oldEntries[oldIndex].ActorObjectPtr.Get(), newEntries[i].SpawnTransform, world);
+			}
+		}
+	}
+
+	// Removed entries go before added ones are spawned
+	for (int32 i = 0; i < numOldEntries; i++)
+	{
+		if (!oldEntryKept[i])
+		{
+			if (AActor* actor = oldEntries[i].ActorObjectPtr.Get())
+			{
+				DestroyEntryActor(actor, world);
+			}
+		}
+	}
+
+	for (int32 i = 0; i < newEntries.Num(); i++)
+	{
+		if (!newEntryMatched[i])
+		{
+			newEntries[i].ActorObjectPtr.Reset();
+
+			TSubclassOf<AActor> actorClass;
+			{
+				SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_LoadEntryClasses);
+				CSV_SCOPED_TIMING_STAT(ViewportWidget, LoadEntryClasses);
+				actorClass = newEntries[i].ActorClassPtr.LoadSynchronous();
+			}
+
+			if (actorClass)
+			{
+				newEntries[i].ActorObjectPtr = SpawnEntryActor(actorClass, newEntries[i].SpawnTransform, world);
+			}
+		}
+
+		// A kept actor keeps the ticking its setup or game code gave it, unless the entry changed its tick setting
+		const int32 oldIndex = newEntryOldIndex[i];
+		if (oldIndex == INDEX_NONE
+			|| oldEntries[oldIndex].bTickInPreview != newEntries[i].bTickInPreview
+			|| oldEntries[oldIndex].ActorObjectPtr != newEntries[i].ActorObjectPtr)
+		{
+			ApplyEntryTickSetting(newEntries[i]);
+		}
+	}
+
+	Entries = newEntries;
+}
+
+AActor* SViewportWidget::SpawnEntryActor(UClass* actorClass, const FTransform& spawnTransform, UWorld* world)
+{
+	EPreviewActorOrigin origin = EPreviewActorOrigin::Spawned;
+	AActor* actor = bUsesSharedScene
+		? PreviewScene->AcquireSharedActor(actorClass, spawnTransform, origin)
+		: PreviewScene->SpawnPooledActor(actorClass, spawnTransform, origin);
+
+	PrepareEntryActor(actor, origin, world);
+
+	return actor;
+}
+
+AActor* SViewportWidget::MoveEntryActor(AActor* actor, const FTransform& spawnTransform, UWorld* world)
+{
+	if (bUsesSharedScene)
+	{
+		EPreviewActorOrigin origin = EPreviewActorOrigin::Shared;
+		AActor* movedActor = PreviewScene->MoveSharedActor(actor, spawnTransform, origin);
+
+		PrepareEntryActor(movedActor, origin, world);
+
+		return movedActor;
+	}
+
+	actor->SetActorTransform(spawnTransform, false, nullptr, ETeleportType::TeleportPhysics);
+
+	return actor;
+}
+
+void SViewportWidget::DestroyEntryActor(AActor* actor, UWorld* world)
+{
+	if (bUsesSharedScene)
+	{
+		PreviewScene->ReleaseSharedActor(actor);
+	}
+	else
+	{
+		PreviewScene->ReleasePooledActor(actor);
+	}
+}
+
+void SViewportWidget::PrepareEntryActor(AActor* actor, EPreviewActorOrigin origin, UWorld* world)
+{
+	if (!actor)
+	{
+		return;
+	}
+
+	if (origin == EPreviewActorOrigin::Spawned)
+	{
+		SetupSpawnedActor(actor, world);
+	}
+	else if (origin == EPreviewActorOrigin::Reused)
+	{
+		ResetPooledActor(actor, world);
+	}
+}
+
+void SViewportWidget::ApplyEntryTickSetting(const FViewportWidgetEntry& entry)
+{
+	AActor* actor = entry.ActorObjectPtr.Get();
+	if (!actor)
+	{
+		return;
+	}
+
+	actor->SetActorTickEnabled(entry.bTickInPreview && actor->PrimaryActorTick.bStartWithTickEnabled);
+
+	for (UActorComponent* component : actor->GetComponents())
+	{
+		if (component)
+		{
+			component->SetComponentTickEnabled(entry.bTickInPreview && component->PrimaryComponentTick.bStartWithTickEnabled);
+		}
+	}
+}
+
+void SViewportWidget::SetEntryActorPoolSize(int32 poolSize)
+{
+	EntryActorPoolSize = poolSize;
+
+	if (PreviewScene.IsValid())
+	{
+		PreviewScene->SetMaxPooledActorsPerClass(poolSize);
+	}
+}
+
+void SViewportWidget::UpdateShowOnlyPrimitives()
+{
+	TSet<FPrimitiveComponentId> showOnlyPrimitives;
+
+	TArray<const AActor*> actors;
+	GetDisplayedActors(actors);
+
+	for (const AActor* actor : actors)
+	{
+		if (actor)
+		{
+			TInlineComponentArray<UPrimitiveComponent*> primitiveComponents(actor);
+			for (const UPrimitiveComponent* primitiveComponent : primitiveComponents)
+			{
+				showOnlyPrimitives.Add(primitiveComponent->ComponentId);
 			}
 		}
 	}
-}
 
-void FCustomViewportClient::HandleWindowDPIScaleChanged(TSharedRef<SWindow> InWindow)
-{
-	RequestUpdateDPIScale();
-	Invalidate();
+	Client->SetShowOnlyPrimitives(showOnlyPrimitives);
+}
+
+void SViewportWidget::GetDisplayedActors(TArray<const AActor*>& OutActors) const
+{
+	if (IsMirroringWorld())
+	{
+		for (const TWeakObjectPtr<AActor>& actor : MirroredActors)
+		{
+			OutActors.Add(actor.Get());
+		}
+
+		return;
+	}
+
+	if (Entries.IsSet())
+	{
+		for (const FViewportWidgetEntry& ViewportWidgetEntry : Entries.Get())
+		{
+			OutActors.Add(ViewportWidgetEntry.ActorObjectPtr.Get());
+		}
+	}
+}
+
+void SViewportWidget::SetMirroredActors(const TArray<AActor*>& actors)
+{
+	TArray<TWeakObjectPtr<AActor>> mirroredActors;
+	UWorld* mirroredWorld = nullptr;
+
+	for (AActor* actor : actors)
+	{
+		if (actor)
+		{
+			mirroredActors.Add(actor);
+			mirroredWorld = mirroredWorld ? mirroredWorld : actor->GetWorld();
+		}
+	}
+
+	if (mirroredActors == MirroredActors)
+	{
+		return;
+	}
+
+	MirroredActors = MoveTemp(mirroredActors);
+	Client->SetMirroredWorld(mirroredWorld);
+
+	// Back to the preview world, which may not exist yet
+	if (!IsMirroringWorld())
+	{
+		Client->SetShowOnlyPrimitives(TOptional<TSet<FPrimitiveComponentId>>());
+	}
+
+	RequestRedraw();
+}
+
+//------------------------------------------------------
+// UViewportWidgetSettings
+//------------------------------------------------------
+
+UViewportWidgetSettings::UViewportWidgetSettings(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Small static previews, most features are invisible at that size
+	FViewportWidgetQualityProfile& thumbnail = QualityProfiles.Add(TEXT("Thumbnail"));
+	thumbnail.AntiAliasingMethod = AAM_FXAA;
+	thumbnail.bDynamicShadows = false;
+
+	FViewportWidgetQualityProfile& portrait = QualityProfiles.Add(TEXT("Portrait"));
+	portrait.AntiAliasingMethod = AAM_FXAA;
+	portrait.bAmbientOcclusion = true;
+	portrait.bBloom = true;
+
+	FViewportWidgetQualityProfile& hero = QualityProfiles.Add(TEXT("Hero"));
+	hero.AntiAliasingMethod = AAM_TemporalAA;
+	hero.bAmbientOcclusion = true;
+	hero.bScreenSpaceReflections = true;
+	hero.bFog = true;
+	hero.bBloom = true;
+	hero.bEyeAdaptation = true;
+	hero.bDepthOfField = true;
+	hero.bOcclusionQueries = true;
+}
+
+const FViewportWidgetQualityProfile* UViewportWidgetSettings::FindQualityProfile(FName Name)
+{
+	return Name.IsNone() ? nullptr : GetDefault<UViewportWidgetSettings>()->QualityProfiles.Find(Name);
+}
+
+//------------------------------------------------------
+// UViewportWidget
+//------------------------------------------------------
+UViewportWidget::UViewportWidget(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	bIsVariable = true;
+}
+
+void UViewportWidget::SynchronizeProperties()
+{
+	Super::SynchronizeProperties();
+
+	if (MyViewport.IsValid())
+	{
+		// Everything is pushed below, including what an open update holds back
+		PendingChanges = EViewportWidgetChanges::None;
+
+		MyViewport->BeginUpdate();
+
+		MyViewport->SetThumbnailCacheKey(GetThumbnailCacheKey());
+		MyViewport->SetViewTransform(ViewTransform);
+		MyViewport->SetEntries(Entries);
+
+		MyViewport->SetRedrawMode(RedrawMode);
+		MyViewport->SetSnapshotFrameCount(SnapshotFrameCount);
+		MyViewport->SetAsyncLoadEntries(bAsyncLoadEntries && !IsDesignTime());
+		MyViewport->SetEntryActorPoolSize(EntryActorPoolSize);
+		MyViewport->SetTickPolicy(TickPolicy);
+		MyViewport->SetResolutionSettings(ResolutionSettings);
+		MyViewport->SetQualityProfile(QualityProfile);
+		MyViewport->SetBatchViews(bBatchSharedSceneViews);
+		MyViewport->GetViewportClient()->SetDrawWhenAppIsHidden(bDrawWhenAppIsHidden);
+
+		SynchronizeMirroredActors();
+
+		FLinearColor linearColor = BackgroundColor.ReinterpretAsLinear();
+		MyViewport->SetViewportBackgroudColor(linearColor);
+		MyViewport->SetViewportFOV(FOV);
+
+		SynchronizeLighting();
+
+		MyViewport->EndUpdate();
+	}
+}
+
+void UViewportWidget::SynchronizeLighting()
+{
+	// Lighting belongs to the scene, so viewports sharing one also share the last lighting applied
+	if (EnablePreviewLighting)
+	{
+		MyViewport->SetViewportSkyBrightness(SkyBrightness);
+		MyViewport->SetViewportLightBrightness(LightBrightness); 
+		MyViewport->SetViewportLightDirection(LightDirection);
+	}
+	else
+	{
+		MyViewport->UpdateCapture();
+		MyViewport->SetViewportSkyBrightness(0);
+		MyViewport->SetViewportLightBrightness(0);
+	}
+}
+
+void UViewportWidget::BeginUpdate()
+{
+	UpdateDepth++;
+}
+
+void UViewportWidget::CommitUpdate()
+{
+	if (!ensureMsgf(UpdateDepth > 0, TEXT("CommitUpdate called without a matching BeginUpdate")))
+	{
+		return;
+	}
+
+	UpdateDepth--;
+	ApplyChanges(EViewportWidgetChanges::None);
+}
+
+void UViewportWidget::ApplyChanges(EViewportWidgetChanges Changes)
+{
+	PendingChanges |= Changes;
+
+	if (UpdateDepth > 0 || PendingChanges == EViewportWidgetChanges::None || !MyViewport.IsValid())
+	{
+		return;
+	}
+
+	const EViewportWidgetChanges changes = PendingChanges;
+	PendingChanges = EViewportWidgetChanges::None;
+
+	MyViewport->BeginUpdate();
+
+	// Every group of properties is part of the image, so any change makes a new key
+	MyViewport->SetThumbnailCacheKey(GetThumbnailCacheKey());
+
+	if (EnumHasAnyFlags(changes, EViewportWidgetChanges::View))
+	{
+		MyViewport->SetViewTransform(ViewTransform);
+	}
+
+	if (EnumHasAnyFlags(changes, EViewportWidgetChanges::Entries))
+	{
+		MyViewport->SetEntries(Entries);
+	}
+
+	if (EnumHasAnyFlags(changes, EViewportWidgetChanges::Appearance))
+	{
+		MyViewport->SetViewportBackgroudColor(BackgroundColor.ReinterpretAsLinear());
+		MyViewport->SetViewportFOV(FOV);
+	}
+
+	if (EnumHasAnyFlags(changes, EViewportWidgetChanges::Lighting))
+	{
+		SynchronizeLighting();
+	}
+
+	if (EnumHasAnyFlags(changes, EViewportWidgetChanges::MirroredActors))
+	{
+		SynchronizeMirroredActors();
+	}
+
+	MyViewport->EndUpdate();
+}
+
+void UViewportWidget::SynchronizeMirroredActors()
+{
+	TArray<AActor*> mirroredActors;
+	for (const TWeakObjectPtr<AActor>& actor : MirroredActors)
+	{
+		mirroredActors.Add(actor.Get());
+	}
+
+	MyViewport->SetMirroredActors(mirroredActors);
+}
+
+void UViewportWidget::ReleaseSlateResources(bool bReleaseChildren)
+{
+	FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+	if (MyViewport.IsValid() && bKeepSceneWarm && !IsDesignTime() && module)
+	{
+		// The content belongs to this widget tree and is released with it
+		MyViewport->SetContent(SNullWidget::NullWidget);
+		module->ParkViewport(GetWarmCacheKey(), MyViewport.ToSharedRef());
+	}
+
+	MyViewport.Reset();
+
+	Super::ReleaseSlateResources(bReleaseChildren);
+}
+
+#if WITH_EDITOR
+const FText UViewportWidget::GetPaletteCategory()
+{
+	return LOCTEXT("Advanced", "Advanced");
+}
+#endif
+
+void UViewportWidget::SetViewTransform(FTransform viewTransform)
+{
+	ViewTransform = viewTransform;
+	ApplyChanges(EViewportWidgetChanges::View);
+}
+
+void UViewportWidget::SetEntries(const TArray<FViewportWidgetEntry>& entries)
+{
+	Entries = entries;
+	ApplyChanges(EViewportWidgetChanges::Entries);
+}
+
+void UViewportWidget::SetFOV(float InFOV)
+{
+	FOV = InFOV;
+	ApplyChanges(EViewportWidgetChanges::Appearance);
+}
+
+void UViewportWidget::SetBackgroundColor(FColor InBackgroundColor)
+{
+	BackgroundColor = InBackgroundColor;
+	ApplyChanges(EViewportWidgetChanges::Appearance);
+}
+
+void UViewportWidget::SetLightBrightness(float InLightBrightness)
+{
+	LightBrightness = InLightBrightness;
+	ApplyChanges(EViewportWidgetChanges::Lighting);
+}
+
+void UViewportWidget::SetLightDirection(FRotator InLightDirection)
+{
+	LightDirection = InLightDirection;
+	ApplyChanges(EViewportWidgetChanges::Lighting);
+}
+
+void UViewportWidget::SetSkyBrightness(float InSkyBrightness)
+{
+	SkyBrightness = InSkyBrightness;
+	ApplyChanges(EViewportWidgetChanges::Lighting);
+}
+
+void UViewportWidget::SetRedrawMode(EViewportWidgetRedrawMode InRedrawMode)
+{
+	RedrawMode = InRedrawMode;
+
+	if (MyViewport.IsValid())
+	{
+		MyViewport->SetRedrawMode(RedrawMode);
+	}
+}
+
+void UViewportWidget::RequestRedraw()
+{
+	if (MyViewport.IsValid())
+	{
+		MyViewport->RequestRedraw();
+	}
+}
+
+void UViewportWidget::SetMirroredActors(const TArray<AActor*>& Actors)
+{
+	MirroredActors.Reset();
+	for (AActor* actor : Actors)
+	{
+		if (actor)
+		{
+			MirroredActors.Add(actor);
+		}
+	}
+
+	ApplyChanges(EViewportWidgetChanges::MirroredActors);
+}
+
+void UViewportWidget::ReadFrameAsync(FOnViewportFrameReadDynamic OnFrameRead)
+{
+	if (!MyViewport.IsValid())
+	{
+		OnFrameRead.ExecuteIfBound(FIntPoint::ZeroValue, TArray<FColor>());
+		return;
+	}
+
+	MyViewport->RequestFrameReadback(FOnViewportFrameRead::CreateLambda([OnFrameRead](FIntPoint size, const TArray<FColor>& pixels)
+	{
+		OnFrameRead.ExecuteIfBound(size, pixels);
+	}));
+}
+
+void UViewportWidget::Prewarm()
+{
+	if (MyViewport.IsValid())
+	{
+		MyViewport->Prewarm();
+	}
+	else
+	{
+		bPrewarmRequested = true;
+	}
+}
+
+void UViewportWidget::SetRealtimeForDuration(float Seconds)
+{
+	if (MyViewport.IsValid())
+	{
+		MyViewport->SetRealtimeForDuration(Seconds);
+	}
+}
+
+bool UViewportWidget::AreEntriesReady() const
+{
+	return MyViewport.IsValid() && !MyViewport->IsLoadingEntries();
+}
+
+void UViewportWidget::HandleEntriesReady()
+{
+	// Without preview lighting the capture sees the entries, which may have spawned after it was made
+	if (!EnablePreviewLighting && MyViewport.IsValid())
+	{
+		MyViewport->InvalidateCapture();
+	}
+
+	OnEntriesReady.Broadcast();
+}
+
+AActor* UViewportWidget::GetSpawnedActor(const int32 entryIndex) const
+{
+	if (MyViewport.IsValid())
+	{
+		return MyViewport->GetSpawnedActor(entryIndex).IsValid() ? MyViewport->GetSpawnedActor(entryIndex).Get() : nullptr;
+	}
+
+	return nullptr;
+}
+
+
+void UViewportWidget::ReleaseWarmScene(FName Key)
+{
+	if (FViewportWidgetModule* module = FViewportWidgetModule::GetPtr())
+	{
+		module->ReleaseParkedViewport(Key);
+	}
+}
+
+UTextureRenderTarget2D* UViewportWidget::RenderThumbnailAtlas(const TArray<FViewportWidgetEntry>& InEntries, const FViewportThumbnailCamera& Camera, int32 CellSize, TArray<FBox2D>& OutUVRects,
+	UTextureRenderTarget2D* RenderTarget, FName QualityProfile)
+{
+	FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+	if (!module)
+	{
+		OutUVRects.Reset();
+		return nullptr;
+	}
+
+	return module->GetThumbnailRenderer().RenderAtlas(InEntries, Camera, CellSize, OutUVRects, RenderTarget, QualityProfile);
+}
+
+void UViewportWidget::ReleaseAllWarmScenes()
+{
+	if (FViewportWidgetModule* module = FViewportWidgetModule::GetPtr())
+	{
+		module->ReleaseAllParkedViewports();
+	}
+}
+
+FName UViewportWidget::GetWarmCacheKey() const
+{
+	if (!WarmCacheKey.IsNone())
+	{
+		return WarmCacheKey;
+	}
+
+	// The same widget of the same user widget class, which is what a reopened menu recreates
+	const UUserWidget* userWidget = GetTypedOuter<UUserWidget>();
+	return FName(*FString::Printf(TEXT("%s.%s"), userWidget ? *userWidget->GetClass()->GetName() : TEXT("None"), *GetName()));
+}
+
+TArray<FString> UViewportWidget::GetQualityProfileNames() const
+{
+	TArray<FString> names;
+	names.Add(FName(NAME_None).ToString());
+
+	for (const TPair<FName, FViewportWidgetQualityProfile>& profile : GetDefault<UViewportWidgetSettings>()->QualityProfiles)
+	{
+		names.Add(profile.Key.ToString());
+	}
+
+	return names;
+}
+
+uint64 UViewportWidget::GetThumbnailCacheKey() const
+{
+	// A mirrored world changes without the widget knowing
+	if (!bUseThumbnailCache || IsDesignTime() || MirroredActors.Num() > 0)
+	{
+		return 0;
+	}
+
+	TArray<uint8> keyData;
+	FMemoryWriter writer(keyData);
+
+	for (const FViewportWidgetEntry& entry : Entries)
+	{
+		FString classPath = entry.ActorClassPtr.ToString();
+		FTransform spawnTransform = entry.SpawnTransform;
+		writer << classPath << spawnTransform;
+	}
+
+	FTransform viewTransform = ViewTransform;
+	float fov = FOV;
+	FColor backgroundColor = BackgroundColor;
+	bool bEnablePreviewLighting = EnablePreviewLighting;
+	FName qualityProfile = QualityProfile;
+	writer << viewTransform << fov << backgroundColor << bEnablePreviewLighting << qualityProfile;
+
+	if (EnablePreviewLighting)
+	{
+		float lightBrightness = LightBrightness;
+		FRotator lightDirection = LightDirection;
+		float skyBrightness = SkyBrightness;
+		writer << lightBrightness << lightDirection << skyBrightness;
+	}
+
+	const uint64 key = CityHash64((const char*)keyData.GetData(), keyData.Num());
+
+	// 0 means no key
+	return key != 0 ? key : 1;
+}
+
+TSharedRef<SWidget> UViewportWidget::RebuildWidget()
+{
+	FViewportWidgetModule* module = FViewportWidgetModule::GetPtr();
+	if (bKeepSceneWarm && !IsDesignTime() && module)
+	{
+		MyViewport = module->UnparkViewport(GetWarmCacheKey());
+	}
+
+	if (MyViewport.IsValid())
+	{
+		MyViewport->SetOnEntriesReady(FSimpleDelegate::CreateUObject(this, &UViewportWidget::HandleEntriesReady));
+
+		// Entries and view are unchanged in the common case, so SynchronizeProperties will not respawn anything
+		MyViewport->RequestRedraw();
+	}
+	else
+	{
+		MyViewport = SNew(SViewportWidget)
+			.ViewTransform(ViewTransform)
+			.Entries(Entries)
+			.SharedSceneName(bUseSharedPreviewScene ? SharedPreviewSceneName : NAME_None)
+			.WorldProfile(WorldProfile)
+			.AsyncLoadEntries(bAsyncLoadEntries && !IsDesignTime())
+			.ThumbnailCacheKey(GetThumbnailCacheKey())
+			.OnEntriesReady(FSimpleDelegate::CreateUObject(this, &UViewportWidget::HandleEntriesReady));
+	}
+
+	if (GetChildrenCount() > 0)
+	{
+		MyViewport->SetContent(GetContentSlot()->Content ? GetContentSlot()->Content->TakeWidget() : SNullWidget::NullWidget);
+	}
+
+	if (bPrewarmRequested)
+	{
+		bPrewarmRequested = false;
+		MyViewport->Prewarm();
+	}
+
+	return MyViewport.ToSharedRef();
+}
+
+//------------------------------------------------------
+// FCustomViewportClient
+//------------------------------------------------------
+
+/** Parameter struct for editor viewport view modifiers */
+struct FCustomViewportViewModifierParams
+{
+	FMinimalViewInfo ViewInfo;
+
+	void AddPostProcessBlend(const FPostProcessSettings& Settings, float Weight)
+	{
+		check(PostProcessSettings.Num() == PostProcessBlendWeights.Num());
+		PostProcessSettings.Add(Settings);
+		PostProcessBlendWeights.Add(Weight);
+	}
+
+private:
+	TArray<FPostProcessSettings> PostProcessSettings;
+	TArray<float> PostProcessBlendWeights;
+
+	friend class FCustomViewportClient;
+};
+
+static int32 ViewOptionIndex = 0;
+static TArray<ECustomViewportType> ViewOptions;
+
+void InitViewOptionsArray()
+{
+	ViewOptions.Empty();
+
+	ECustomViewportType Front = ECustomViewportType::CVT_OrthoXZ;
+	ECustomViewportType Back = ECustomViewportType::CVT_OrthoNegativeXZ;
+	ECustomViewportType Top = ECustomViewportType::CVT_OrthoXY;
+	ECustomViewportType Bottom = ECustomViewportType::CVT_OrthoNegativeXY;
+	ECustomViewportType Left = ECustomViewportType::CVT_OrthoYZ;
+	ECustomViewportType Right = ECustomViewportType::CVT_OrthoNegativeYZ;
+
+	ViewOptions.Add(Front);
+	ViewOptions.Add(Back);
+	ViewOptions.Add(Top);
+	ViewOptions.Add(Bottom);
+	ViewOptions.Add(Left);
+	ViewOptions.Add(Right);
+}
+
+const EViewModeIndex FCustomViewportClient::DefaultPerspectiveViewMode = VMI_Lit;
+const EViewModeIndex FCustomViewportClient::DefaultOrthoViewMode = VMI_BrushWireframe;
+
+float ComputeOrthoZoomFactor(const float ViewportWidth)
+{
+	float Ret = 1.0f;
+
+	// We want to have all ortho view ports scale the same way to have the axis aligned with each other.
+	// So we take out the usual scaling of a view based on it's width.
+	// That means when a view port is resized in x or y it shows more content, not the same content larger (for x) or has no effect (for y).
+	// 500 is to get good results with existing view port settings.
+	Ret = ViewportWidth / 500.0f;
+
+	return Ret;
+}
+
+namespace OrbitConstants_NM
+{
+	const float OrbitPanSpeed = 1.0f;
+	const float IntialLookAtDistance = 1024.f;
+}
+
+namespace CustomViewportDefs_NM
+{
+	/** Default camera field of view angle for level editor perspective viewports */
+	const float DefaultPerspectiveFOVAngle(90.0f);
+}
+
+/** GPU timestamps around the renders of one viewport, read back a few frames later without stalling */
+class FViewportGPUTimer
+{
+public:
+	FViewportGPUTimer()
+		: WriteIndex(0)
+		, LastTimeMicroseconds(-1)
+	{}
+
+	void Begin_RenderThread(FRHICommandListImmediate& RHICmdList)
+	{
+		FSlot& slot = Slots[WriteIndex];
+
+		// The slot is reused three renders later, its queries have normally landed by then
+		if (slot.bPending)
+		{
+			uint64 beginTime = 0;
+			uint64 endTime = 0;
+			if (RHIGetRenderQueryResult(slot.BeginQuery, beginTime, false) && RHIGetRenderQueryResult(slot.EndQuery, endTime, false) && endTime >= beginTime)
+			{
+				LastTimeMicroseconds.Set((int32)FMath::Min<uint64>(endTime - beginTime, MAX_int32));
+			}
+
+			slot.bPending = false;
+		}
+
+		if (!slot.BeginQuery.IsValid())
+		{
+			slot.BeginQuery = RHICreateRenderQuery(RQT_AbsoluteTime);
+			slot.EndQuery = RHICreateRenderQuery(RQT_AbsoluteTime);
+		}
+
+		RHICmdList.EndRenderQuery(slot.BeginQuery);
+	}
+
+	void End_RenderThread(FRHICommandListImmediate& RHICmdList)
+	{
+		FSlot& slot = Slots[WriteIndex];
+
+		RHICmdList.EndRenderQuery(slot.EndQuery);
+		slot.bPending = true;
+
+		WriteIndex = (WriteIndex + 1) % NumSlots;
+	}
+
+	bool ConsumeTime(float& OutTimeMs)
+	{
+		const int32 timeMicroseconds = LastTimeMicroseconds.Set(-1);
+		if (timeMicroseconds < 0)
+		{
+			return false;
+		}
+
+		OutTimeMs = timeMicroseconds / 1000.f;
+		return true;
+	}
+
+private:
+	struct FSlot
+	{
+		FRenderQueryRHIRef BeginQuery;
+		FRenderQueryRHIRef EndQuery;
+		bool bPending = false;
+	};
+
+	static const int32 NumSlots = 3;
+
+	FSlot Slots[NumSlots];
+	int32 WriteIndex;
+
+	/** Written on the render thread, consumed on the game thread, -1 once consumed */
+	FThreadSafeCounter LastTimeMicroseconds;
+};
+
+FCustomUMGViewportClient::FCustomUMGViewportClient(FPreviewScene* InPreviewScene)
+	: bDrawWhenAppIsHidden(false)
+	, ResolutionFraction(1.f)
+	, WindowDPIScale(1.f)
+	, LevelTick(LEVELTICK_All)
+{
+	PreviewScene = InPreviewScene;
+}
+
+FCustomUMGViewportClient::~FCustomUMGViewportClient()
+{
+}
+
+FSceneView* FCustomUMGViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_CalcSceneView);
+
+	FSceneView* View = FUMGViewportClient::CalcSceneView(ViewFamily);
+
+	if (ShowOnlyPrimitives.IsSet())
+	{
+		View->ShowOnlyPrimitives = ShowOnlyPrimitives;
+	}
+
+	ApplyQualityProfile(View);
+
+	return View;
+}
+
+void FCustomUMGViewportClient::SetQualityProfile(const FViewportWidgetQualityProfile* InQualityProfile)
+{
+	QualityProfile.Reset();
+	if (InQualityProfile)
+	{
+		QualityProfile = *InQualityProfile;
+	}
+}
+
+void FCustomUMGViewportClient::ApplyQualityProfile(FEngineShowFlags& ShowFlags) const
+{
+	if (!QualityProfile.IsSet())
+	{
+		return;
+	}
+
+	const FViewportWidgetQualityProfile& Profile = QualityProfile.GetValue();
+
+	ShowFlags.SetAntiAliasing(Profile.AntiAliasingMethod != AAM_None);
+	ShowFlags.SetTemporalAA(Profile.AntiAliasingMethod == AAM_TemporalAA);
+	ShowFlags.SetAmbientOcclusion(Profile.bAmbientOcclusion);
+	ShowFlags.SetScreenSpaceReflections(Profile.bScreenSpaceReflections);
+	ShowFlags.SetDynamicShadows(Profile.bDynamicShadows);
+	ShowFlags.SetFog(Profile.bFog);
+	ShowFlags.SetBloom(Profile.bBloom);
+	ShowFlags.SetEyeAdaptation(Profile.bEyeAdaptation);
+	ShowFlags.SetDepthOfField(Profile.bDepthOfField);
+	ShowFlags.SetMotionBlur(Profile.bMotionBlur);
+
+	for (const TPair<FString, bool>& ShowFlagOverride : Profile.ShowFlagOverrides)
+	{
+		const int32 FlagIndex = FEngineShowFlags::FindIndexByName(*ShowFlagOverride.Key);
+		if (FlagIndex != INDEX_NONE)
+		{
+			ShowFlags.SetSingleFlag(FlagIndex, ShowFlagOverride.Value);
+		}
+	}
+}
+
+void FCustomUMGViewportClient::ApplyQualityProfile(FSceneView* View) const
+{
+	if (!QualityProfile.IsSet())
+	{
+		return;
+	}
+
+	View->AntiAliasingMethod = QualityProfile->AntiAliasingMethod;
+	View->bDisableQuerySubmissions = !QualityProfile->bOcclusionQueries;
+}
+
+void FCustomUMGViewportClient::Draw(FViewport* InViewport, FCanvas* Canvas)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_Draw);
+	CSV_SCOPED_TIMING_STAT(ViewportWidget, Draw);
+
+	UWorld* World = GetWorld();
+
+	// The preview world is created lazily, a resize can ask for a draw before it exists
+	if (!World || !GetScene())
+	{
+		return;
+	}
+
+	FViewport* ViewportBackup = Viewport;
+	Viewport = InViewport ? InViewport : Viewport;
+
+	// Use time relative to start time to avoid issues with float vs double
+	const float TimeSeconds = FApp::GetCurrentTime() - GStartTime;
+	const float RealTimeSeconds = FApp::GetCurrentTime() - GStartTime;
+	const float DeltaTimeSeconds = FApp::GetDeltaTime();
+
+	// Setup a FSceneViewFamily/FSceneView for the viewport.
+	FSceneViewFamilyContext ViewFamily(FSceneViewFamily::ConstructionValues(
+		Canvas->GetRenderTarget(),
+		GetScene(),
+		GetViewFamilyShowFlags())
+		.SetWorldTimes(TimeSeconds, DeltaTimeSeconds, RealTimeSeconds)
+		.SetRealtimeUpdate(true));
+
+	FSceneView* View = CalcSceneView(&ViewFamily);
+
+	ViewFamily.SetScreenPercentageInterface(new FLegacyScreenPercentageDriver(
+		ViewFamily, ResolutionFraction, /* AllowPostProcessSettingsScreenPercentage = */ false));
+
+	View->CameraConstrainedViewRect = View->UnscaledViewRect;
+
+	Canvas->Clear(GetBackgroundColor());
+
+	// workaround for hacky renderer code that uses GFrameNumber to decide whether to resize render targets
+	--GFrameNumber;
+
+	if (GPUTimer.IsValid())
+	{
+		ENQUEUE_RENDER_COMMAND(ViewportWidgetBeginGPUTimer)([GPUTimer = GPUTimer](FRHICommandListImmediate& RHICmdList)
+		{
+			GPUTimer->Begin_RenderThread(RHICmdList);
+		});
+	}
+
+	// Draw the 3D scene
+	GetRendererModule().BeginRenderingViewFamily(Canvas, &ViewFamily);
+
+	if (GPUTimer.IsValid())
+	{
+		ENQUEUE_RENDER_COMMAND(ViewportWidgetEndGPUTimer)([GPUTimer = GPUTimer](FRHICommandListImmediate& RHICmdList)
+		{
+			GPUTimer->End_RenderThread(RHICmdList);
+		});
+	}
+
+	// Remove temporary debug lines. A mirrored world's belong to its game viewport
+	if (!IsMirroringWorld())
+	{
+		if (World->LineBatcher != NULL && (World->LineBatcher->BatchedLines.Num() || World->LineBatcher->BatchedPoints.Num()))
+		{
+			World->LineBatcher->Flush();
+		}
+
+		if (World->ForegroundLineBatcher != NULL && (World->ForegroundLineBatcher->BatchedLines.Num() || World->ForegroundLineBatcher->BatchedPoints.Num()))
+		{
+			World->ForegroundLineBatcher->Flush();
+		}
+	}
+
+	Viewport = ViewportBackup;
+}
+
+UWorld* FCustomUMGViewportClient::GetWorld() const
+{
+	if (UWorld* World = MirroredWorld.Get())
+	{
+		return World;
+	}
+
+	return FUMGViewportClient::GetWorld();
+}
+
+FSceneInterface* FCustomUMGViewportClient::GetScene() const
+{
+	if (UWorld* World = MirroredWorld.Get())
+	{
+		return World->Scene;
+	}
+
+	return FUMGViewportClient::GetScene();
+}
+
+void FCustomUMGViewportClient::SetWindowDPIScale(float InDPIScale)
+{
+	if (WindowDPIScale != InDPIScale)
+	{
+		WindowDPIScale = InDPIScale;
+		RequestUpdateDPIScale();
+	}
+}
+
+void FCustomUMGViewportClient::SetMeasureGPUTime(bool bMeasure)
+{
+	if (bMeasure && !GPUTimer.IsValid() && GSupportsTimestampRenderQueries)
+	{
+		GPUTimer = MakeShared<FViewportGPUTimer, ESPMode::ThreadSafe>();
+	}
+	else if (!bMeasure)
+	{
+		GPUTimer.Reset();
+	}
+}
+
+bool FCustomUMGViewportClient::ConsumeGPUTime(float& OutGPUTimeMs)
+{
+	return GPUTimer.IsValid() && GPUTimer->ConsumeTime(OutGPUTimeMs);
+}
+
+FSceneView* FCustomUMGViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily, const FIntRect& ViewRect)
+{
+	return CalcSceneViewInRect(ViewFamily, ViewRect, nullptr);
+}
+
+FSceneView* FCustomUMGViewportClient::CalcBatchedSceneView(FSceneViewFamily* ViewFamily, const FIntRect& ViewRect)
+{
+	return CalcSceneViewInRect(ViewFamily, ViewRect, ViewState.GetReference());
+}
+
+FSceneView* FCustomUMGViewportClient::CalcSceneViewInRect(FSceneViewFamily* ViewFamily, const FIntRect& ViewRect, FSceneViewStateInterface* InViewState)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_CalcSceneView);
+
+	FMinimalViewInfo CellViewInfo = ViewInfo;
+	CellViewInfo.Location = GetViewLocation();
+	CellViewInfo.Rotation = GetViewRotation();
+	CellViewInfo.AspectRatio = ViewRect.Width() / (float)FMath::Max(ViewRect.Height(), 1);
+	CellViewInfo.bConstrainAspectRatio = false;
+
+	FSceneViewInitOptions ViewInitOptions;
+	ViewInitOptions.SetViewRectangle(ViewRect);
+
+	ViewInitOptions.ViewOrigin = CellViewInfo.Location;
+
+	ViewInitOptions.ViewRotationMatrix = FInverseRotationMatrix(CellViewInfo.Rotation);
+	ViewInitOptions.ViewRotationMatrix = ViewInitOptions.ViewRotationMatrix * FMatrix(
+		FPlane(0, 0, 1, 0),
+		FPlane(1, 0, 0, 0),
+		FPlane(0, 1, 0, 0),
+		FPlane(0, 0, 0, 1));
+
+	ViewInitOptions.ProjectionMatrix = CellViewInfo.CalculateProjectionMatrix();
+
+	ViewInitOptions.ViewFamily = ViewFamily;
+	ViewInitOptions.SceneViewStateInterface = InViewState;
+	ViewInitOptions.BackgroundColor = GetBackgroundColor();
+
+	FSceneView* View = new FSceneView(ViewInitOptions);
+
+	if (ShowOnlyPrimitives.IsSet())
+	{
+		View->ShowOnlyPrimitives = ShowOnlyPrimitives;
+	}
+
+	ViewFamily->Views.Add(View);
+
+	View->StartFinalPostprocessSettings(CellViewInfo.Location);
+	View->EndFinalPostprocessSettings(ViewInitOptions);
+
+	ApplyQualityProfile(View);
+
+	return View;
+}
+
+FEngineShowFlags FCustomUMGViewportClient::GetViewFamilyShowFlags() const
+{
+	FEngineShowFlags ShowFlags = EngineShowFlags;
+	ShowFlags.ScreenPercentage = true;
+	ApplyQualityProfile(ShowFlags);
+
+	return ShowFlags;
+}
+
+void FCustomUMGViewportClient::DrawOffscreen(FCanvas* Canvas)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_Draw);
+	CSV_SCOPED_TIMING_STAT(ViewportWidget, Draw);
+
+	FRenderTarget* RenderTarget = Canvas->GetRenderTarget();
+
+	if (!GetWorld() || !GetScene() || !RenderTarget)
+	{
+		return;
+	}
+
+	const float TimeSeconds = FApp::GetCurrentTime() - GStartTime;
+
+	FSceneViewFamilyContext ViewFamily(FSceneViewFamily::ConstructionValues(
+		RenderTarget,
+		GetScene(),
+		GetViewFamilyShowFlags())
+		.SetWorldTimes(TimeSeconds, FApp::GetDeltaTime(), TimeSeconds));
+
+	// An offscreen render has no history to blur or adapt from
+	ViewFamily.EngineShowFlags.MotionBlur = 0;
+
+	CalcSceneView(&ViewFamily, FIntRect(FIntPoint::ZeroValue, RenderTarget->GetSizeXY()));
+
+	ViewFamily.SetScreenPercentageInterface(new FLegacyScreenPercentageDriver(
+		ViewFamily, ResolutionFraction, /* AllowPostProcessSettingsScreenPercentage = */ false));
+
+	Canvas->Clear(GetBackgroundColor());
+
+	GetRendererModule().BeginRenderingViewFamily(Canvas, &ViewFamily);
+}
+
+FCustomViewportClient::FCustomViewportClient(FPreviewScene* InPreviewScene, const TWeakPtr<SViewportWidget>& InViewportWidget)
+	: ImmersiveDelegate()
+	, VisibilityDelegate()
+	, Viewport(NULL)
+	, ViewportType(ECustomViewportType::CVT_Perspective)
+	, ViewState()
+	, StereoViewStates()
+	, EngineShowFlags(ESFIM_Editor)
+	, LastEngineShowFlags(ESFIM_Game)
+	, ExposureSettings()
+	, CurrentBufferVisualizationMode(NAME_None)
+	, CurrentNaniteVisualizationMode(NAME_None)
+	, CurrentLumenVisualizationMode(NAME_None)
+	, CurrentGroomVisualizationMode(NAME_None)
+	, CurrentVirtualShadowMapVisualizationMode(NAME_None)
+	, CurrentRayTracingDebugVisualizationMode(NAME_None)
+	, CurrentGPUSkinCacheVisualizationMode(NAME_None)
+	, ViewFOV(CustomViewportDefs_NM::DefaultPerspectiveFOVAngle)
+	, FOVAngle(CustomViewportDefs_NM::DefaultPerspectiveFOVAngle)
+	, bForcingUnlitForNewMap(false)
+	, bNeedsRedraw(true)
+	, LandscapeLODOverride(-1)
+	, TimeForForceRedraw(0.0)
+	, CurrentMousePos(-1, -1)
+	, bIsRealtime(true)
+	, PreviewScene(InPreviewScene)
+	, PerspViewModeIndex(DefaultPerspectiveViewMode)
+	, OrthoViewModeIndex(DefaultOrthoViewMode)
+	, ViewModeParam(-1)
+	, NearPlane(-1.0f)
+	, FarPlane(0.0f)
+	, bInGameViewMode(false)
+{
+	InitViewOptionsArray();
+
+	FSceneInterface* Scene = GetScene();
+#if ENGINE_MAJOR_VERSION >= 5
+	ViewState.Allocate(Scene ? Scene->GetFeatureLevel() : GMaxRHIFeatureLevel);
+#else
+	ViewState.Allocate();
+#endif
+	// NOTE: StereoViewState will be allocated on demand, for viewports than end up drawing in stereo
+
+	// Most editor viewports do not want motion blur.
+	EngineShowFlags.MotionBlur = 0;
+
+	EngineShowFlags.SetSnap(1);
+
+	SetViewMode(IsPerspective() ? PerspViewModeIndex : OrthoViewModeIndex);
+
+	RequestUpdateDPIScale();
+
+#if WITH_EDITOR
+	FSlateApplication::Get().OnWindowDPIScaleChanged().AddRaw(this, &FCustomViewportClient::HandleWindowDPIScaleChanged);
+#endif
+}
+
+FCustomViewportClient::~FCustomViewportClient()
+{
+	if (Viewport)
+	{
+		UE_LOG(LogTemp, Fatal, TEXT("Viewport != NULL in FCustomViewportClient destructor."));
+	}
+
+	if (FSlateApplication::IsInitialized())
+	{
+#if WITH_EDITOR
+		FSlateApplication::Get().OnWindowDPIScaleChanged().RemoveAll(this);
+#endif
+	}
+}
+
+bool FCustomViewportClient::ToggleRealtime()
+{
+	SetRealtime(!bIsRealtime);
+	return bIsRealtime;
+}
+
+float FCustomViewportClient::GetOrthoUnitsPerPixel(const FViewport* InViewport) const
+{
+	const float SizeX = static_cast<float>(InViewport->GetSizeXY().X);
+
+	// 15.0f was coming from the CAMERA_ZOOM_DIV marco, seems it was chosen arbitrarily
+	return (1 / (SizeX * 15.f)) * ComputeOrthoZoomFactor(SizeX);
+}
+
+void FCustomViewportClient::SetInitialViewTransform(ECustomViewportType InViewportType, const FVector& ViewLocation, const FRotator& ViewRotation)
+{
+	FCustomViewportCameraTransform& ViewTransform = (InViewportType == ECustomViewportType::CVT_Perspective) ? ViewTransformPerspective : ViewTransformOrthographic;
+
+	ViewTransform.SetLocation(ViewLocation);
+	ViewTransform.SetRotation(ViewRotation);
+
+	// Make a look at location in front of the camera
+	const FQuat CameraOrientation = FQuat::MakeFromEuler(ViewRotation.Euler());
+	FVector Direction = CameraOrientation.RotateVector(FVector(1, 0, 0));
+
+	ViewTransform.SetLookAt(ViewLocation + Direction * OrbitConstants_NM::IntialLookAtDistance);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// Configures the specified FSceneView object with the view and projection matrices for this viewport.
+
+FSceneView* FCustomViewportClient::CalcSceneView(FSceneViewFamily* ViewFamily, const int32 StereoViewIndex)
+{
+	const bool bStereoRendering = StereoViewIndex != INDEX_NONE;
+
+	FSceneViewInitOptions ViewInitOptions;
+
+	FCustomViewportCameraTransform& ViewTransform = GetViewTransform();
+	const ECustomViewportType EffectiveViewportType = GetViewportType();
+
+	// Apply view modifiers.
+	FCustomViewportViewModifierParams ViewModifierParams;
+	{
+		ViewModifierParams.ViewInfo.Location = ViewTransform.GetLocation();
+		ViewModifierParams.ViewInfo.Rotation = ViewTransform.GetRotation();
+
+		ViewModifierParams.ViewInfo.FOV = ViewFOV;
+	}
+	const FVector ModifiedViewLocation = ViewModifierParams.ViewInfo.Location;
+	FRotator ModifiedViewRotation = ViewModifierParams.ViewInfo.Rotation;
+	const float ModifiedViewFOV = ViewModifierParams.ViewInfo.FOV;
+
+	ViewInitOptions.ViewOrigin = ModifiedViewLocation;
+
+	FIntPoint ViewportSize = Viewport->GetSizeXY();
+	ViewportSize.X = FMath::Max(ViewportSize.X, 1);
+	ViewportSize.Y = FMath::Max(ViewportSize.Y, 1);
+	FIntPoint ViewportOffset(0, 0);
+	ViewInitOptions.SetViewRectangle(FIntRect(ViewportOffset, ViewportOffset + ViewportSize));
+
+	ViewInitOptions.ViewRotationMatrix = FInverseRotationMatrix(ViewModifierParams.ViewInfo.Rotation);
+	ViewInitOptions.ViewRotationMatrix = ViewInitOptions.ViewRotationMatrix * FMatrix(
+		FPlane(0, 0, 1, 0),
+		FPlane(1, 0, 0, 0),
+		FPlane(0, 1, 0, 0),
+		FPlane(0, 0, 0, 1));
+
+	EAspectRatioAxisConstraint AspectRatioAxisConstraint = EAspectRatioAxisConstraint::AspectRatio_MajorAxisFOV;
+	FMinimalViewInfo::CalculateProjectionMatrixGivenView(ViewModifierParams.ViewInfo, AspectRatioAxisConstraint, Viewport, /*inout*/ ViewInitOptions);
+
+	{
+		//
+		if (EffectiveViewportType == ECustomViewportType::CVT_Perspective)
+		{
+			// Calc view rotation matrix
+			ViewInitOptions.ViewRotationMatrix = CalcViewRotationMatrix(ModifiedViewRotation);
+
+			// Rotate view 90 degrees
+			ViewInitOptions.ViewRotationMatrix = ViewInitOptions.ViewRotationMatrix * FMatrix(
+				FPlane(0, 0, 1, 0),
+				FPlane(1, 0, 0, 0),
+				FPlane(0, 1, 0, 0),
+				FPlane(0, 0, 0, 1));
+
+			{
+				const float MinZ = GetNearClipPlane();
+				const float MaxZ = MinZ;
+				// Avoid zero ViewFOV's which cause divide by zero's in projection matrix
+				const float MatrixFOV = FMath::Max(0.001f, ModifiedViewFOV) * (float)PI / 360.0f;
+
+				{
+					float XAxisMultiplier;
+					float YAxisMultiplier;
+
+					if (((ViewportSize.X > ViewportSize.Y) && (AspectRatioAxisConstraint == AspectRatio_MajorAxisFOV)) || (AspectRatioAxisConstraint == AspectRatio_MaintainXFOV))
+					{
+						//if the viewport is wider than it is tall
+						XAxisMultiplier = 1.0f;
+						YAxisMultiplier = ViewportSize.X / (float)ViewportSize.Y;
+					}
+					else
+					{
+						//if the viewport is taller than it is wide
+						XAxisMultiplier = ViewportSize.Y / (float)ViewportSize.X;
+						YAxisMultiplier = 1.0f;
+					}
+
+					if ((bool)ERHIZBuffer::IsInverted)
+					{
+						ViewInitOptions.ProjectionMatrix = FReversedZPerspectiveMatrix(
+							MatrixFOV,
+							MatrixFOV,
+							XAxisMultiplier,
+							YAxisMultiplier,
+							MinZ,
+							MaxZ
+						);
+					}
+					else
+					{
+						ViewInitOptions.ProjectionMatrix = FPerspectiveMatrix(
+							MatrixFOV,
+							MatrixFOV,
+							XAxisMultiplier,
+							YAxisMultiplier,
+							MinZ,
+							MaxZ
+						);
+					}
+				}
+			}
+		}
+		else
+		{
+			static_assert((bool)ERHIZBuffer::IsInverted, "Check all the Rotation Matrix transformations!");
+			float ZScale = 0.5f / WORLD_MAX;	// LWC_TODO: WORLD_MAX misuse?
+			float ZOffset = WORLD_MAX;
+
+			//The divisor for the matrix needs to match the translation code.
+			const float Zoom = GetOrthoUnitsPerPixel(Viewport);
+
+			float OrthoWidth = Zoom * ViewportSize.X / 2.0f;
+			float OrthoHeight = Zoom * ViewportSize.Y / 2.0f;
+
+			if (EffectiveViewportType == ECustomViewportType::CVT_OrthoXY)
+			{
+				ViewInitOptions.ViewRotationMatrix = FMatrix(
+					FPlane(1, 0, 0, 0),
+					FPlane(0, -1, 0, 0),
+					FPlane(0, 0, -1, 0),
+					FPlane(0, 0, 0, 1));
+			}
+			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoXZ)
+			{
+				ViewInitOptions.ViewRotationMatrix = FMatrix(
+					FPlane(1, 0, 0, 0),
+					FPlane(0, 0, -1, 0),
+					FPlane(0, 1, 0, 0),
+					FPlane(0, 0, 0, 1));
+			}
+			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoYZ)
+			{
+				ViewInitOptions.ViewRotationMatrix = FMatrix(
+					FPlane(0, 0, 1, 0),
+					FPlane(1, 0, 0, 0),
+					FPlane(0, 1, 0, 0),
+					FPlane(0, 0, 0, 1));
+			}
+			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoNegativeXY)
+			{
+				ViewInitOptions.ViewRotationMatrix = FMatrix(
+					FPlane(-1, 0, 0, 0),
+					FPlane(0, -1, 0, 0),
+					FPlane(0, 0, 1, 0),
+					FPlane(0, 0, 0, 1));
+			}
+			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoNegativeXZ)
+			{
+				ViewInitOptions.ViewRotationMatrix = FMatrix(
+					FPlane(-1, 0, 0, 0),
+					FPlane(0, 0, 1, 0),
+					FPlane(0, 1, 0, 0),
+					FPlane(0, 0, 0, 1));
+			}
+			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoNegativeYZ)
+			{
+				ViewInitOptions.ViewRotationMatrix = FMatrix(
+					FPlane(0, 0, -1, 0),
+					FPlane(-1, 0, 0, 0),
+					FPlane(0, 1, 0, 0),
+					FPlane(0, 0, 0, 1));
+			}
+			else if (EffectiveViewportType == ECustomViewportType::CVT_OrthoFreelook)
+			{
+				ViewInitOptions.ViewRotationMatrix = FMatrix(
+					FPlane(0, 0, 1, 0),
+					FPlane(1, 0, 0, 0),
+					FPlane(0, 1, 0, 0),
+					FPlane(0, 0, 0, 1));
+			}
+			else
+			{
+				// Unknown viewport type
+				check(false);
+			}
+
+			ViewInitOptions.ProjectionMatrix = FReversedZOrthoMatrix(
+				OrthoWidth,
+				OrthoHeight,
+				ZScale,
+				ZOffset
+			);
+		}
+	}
+
+	if (!ViewInitOptions.IsValidViewRectangle())
+	{
+		// Zero sized rects are invalid, so fake to 1x1 to avoid asserts later on
+		ViewInitOptions.SetViewRectangle(FIntRect(0, 0, 1, 1));
+	}
+
+	ViewInitOptions.ViewFamily = ViewFamily;
+	ViewInitOptions.SceneViewStateInterface = ViewState.GetReference();
+
+	ViewInitOptions.BackgroundColor = GetBackgroundColor();
+
+	ViewInitOptions.FOV = ModifiedViewFOV;
+
+	ViewInitOptions.OverrideFarClippingPlaneDistance = FarPlane;
+	ViewInitOptions.CursorPos = CurrentMousePos;
+
+	FSceneView* View = new FSceneView(ViewInitOptions);
+
+	View->ViewLocation = ModifiedViewLocation;
+	View->ViewRotation = ModifiedViewRotation;
+
+	int32 FamilyIndex = ViewFamily->Views.Add(View);
+	//check(FamilyIndex == View->StereoViewIndex || View->StereoViewIndex == INDEX_NONE);
+
+	View->StartFinalPostprocessSettings(View->ViewLocation);
+
+	OverridePostProcessSettings(*View);
+
+	if (ViewModifierParams.ViewInfo.PostProcessBlendWeight > 0.f)
+	{
+		View->OverridePostProcessSettings(ViewModifierParams.ViewInfo.PostProcessSettings, ViewModifierParams.ViewInfo.PostProcessBlendWeight);
+	}
+	const int32 PPNum = FMath::Min(ViewModifierParams.PostProcessSettings.Num(), ViewModifierParams.PostProcessBlendWeights.Num());
+	for (int32 PPIndex = 0; PPIndex < PPNum; ++PPIndex)
+	{
+		const FPostProcessSettings& PPSettings = ViewModifierParams.PostProcessSettings[PPIndex];
+		const float PPWeight = ViewModifierParams.PostProcessBlendWeights[PPIndex];
+		View->OverridePostProcessSettings(PPSettings, PPWeight);
+	}
+
+	View->EndFinalPostprocessSettings(ViewInitOptions);
+
+	for (int ViewExt = 0; ViewExt < ViewFamily->ViewExtensions.Num(); ViewExt++)
+	{
+		ViewFamily->ViewExtensions[ViewExt]->SetupView(*ViewFamily, *View);
+	}
+
+	return View;
+}
+
+void FCustomUMGViewportClient::Tick(float InDeltaTime)
+{
+	if (!GIntraFrameDebuggingGameThread && PreviewScene)
+	{
+		// Begin Play
+		UWorld* PreviewWorld = PreviewScene->GetWorld();
+		if (!PreviewWorld->bBegunPlay)
+		{
+			for (FActorIterator It(PreviewWorld); It; ++It)
+			{
+				It->DispatchBeginPlay();
+			}
+			PreviewWorld->bBegunPlay = true;
+		}
+
+		// Tick
+		PreviewWorld->Tick(LevelTick, InDeltaTime);
+	}
+}
+
+void FCustomViewportClient::Tick(float DeltaTime)
+{
+	if (!GIntraFrameDebuggingGameThread)
+	{
+		// Begin Play
+		UWorld* PreviewWorld = PreviewScene->GetWorld();
+		if (!PreviewWorld->bBegunPlay)
+		{
+			for (FActorIterator It(PreviewWorld); It; ++It)
+			{
+				It->DispatchBeginPlay();
+			}
+			PreviewWorld->bBegunPlay = true;
+		}
+
+		// Tick
+		PreviewWorld->Tick(LEVELTICK_All, DeltaTime);
+	}
+}
+
+void FCustomViewportClient::SetViewportType(ECustomViewportType InViewportType)
+{
+	ViewportType = InViewportType;
+
+	// Changing the type may also change the active view mode; re-apply that now
+	ApplyViewMode(GetViewMode(), IsPerspective(), EngineShowFlags);
+
+	// We might have changed to an orthographic viewport; if so, update any viewport links
+	UpdateLinkedOrthoViewports(true);
+
+	Invalidate();
+}
+
+void FCustomViewportClient::RotateViewportType()
+{
+	ViewportType = ViewOptions[ViewOptionIndex];
+
+	// Changing the type may also change the active view mode; re-apply that now
+	ApplyViewMode(GetViewMode(), IsPerspective(), EngineShowFlags);
+
+	// We might have changed to an orthographic viewport; if so, update any viewport links
+	UpdateLinkedOrthoViewports(true);
+
+	Invalidate();
+
+	if (ViewOptionIndex == 5)
+	{
+		ViewOptionIndex = 0;
+	}
+	else
+	{
+		ViewOptionIndex++;
+	}
+}
+
+bool FCustomViewportClient::IsActiveViewportTypeInRotation() const { return GetViewportType() == ViewOptions[ViewOptionIndex]; }
+
+bool FCustomViewportClient::IsPerspective() const { return (GetViewportType() == ECustomViewportType::CVT_Perspective); }
+/**
+ * Forcibly disables lighting show flags if there are no lights in the scene, or restores lighting show
+ * flags if lights are added to the scene.
+ */
+void FCustomViewportClient::UpdateLightingShowFlags(FEngineShowFlags& InOutShowFlags)
+{
+	bool bViewportNeedsRefresh = false;
+
+	if (bForcingUnlitForNewMap && !bInGameViewMode && IsPerspective())
+	{
+		// We'll only use default lighting for viewports that are viewing the main world
+		if (GWorld != NULL && GetScene() != NULL && GetScene()->GetWorld() != NULL && GetScene()->GetWorld() == GWorld)
+		{
+			// Check to see if there are any lights in the scene
+			bool bAnyLights = GetScene()->HasAnyLights();
+			if (bAnyLights)
+			{
+				// Is unlit mode currently enabled?  We'll make sure that all of the regular unlit view
+				// mode show flags are set (not just EngineShowFlags.Lighting), so we don't disrupt other view modes
+				if (!InOutShowFlags.Lighting)
+				{
+					// We have lights in the scene now so go ahead and turn lighting back on
+					// designer can see what they're interacting with!
+					InOutShowFlags.SetLighting(true);
+				}
+
+				// No longer forcing lighting to be off
+				bForcingUnlitForNewMap = false;
+			}
+			else
+			{
+				// Is lighting currently enabled?
+				if (InOutShowFlags.Lighting)
+				{
+					// No lights in the scene, so make sure that lighting is turned off so the level
+					// designer can see what they're interacting with!
+					InOutShowFlags.SetLighting(false);
+				}
+			}
+		}
+	}
+}
+
+void FCustomViewportClient::HandleWindowDPIScaleChanged(TSharedRef<SWindow> InWindow)
+{
+	RequestUpdateDPIScale();
+	Invalidate();
+}
+
+void FCustomViewportClient::HandleToggleShowFlag(FEngineShowFlags::EShowFlag EngineShowFlagIndex)
+{
+	const bool bOldState = EngineShowFlags.GetSingleFlag(EngineShowFlagIndex);
+	EngineShowFlags.SetSingleFlag(EngineShowFlagIndex, !bOldState);
+
+	// Invalidate clients which aren't real-time so we see the changes.
+	Invalidate();
+}
+
+
+bool FCustomViewportClient::IsVisualizeCalibrationMaterialEnabled() const
+{
+	// Get the list of requested buffers from the console
+	const URendererSettings* Settings = GetDefault<URendererSettings>();
+	check(Settings);
+
+	return ((EngineShowFlags.VisualizeCalibrationCustom && Settings->VisualizeCalibrationCustomMaterialPath.IsValid()) ||
+		(EngineShowFlags.VisualizeCalibrationColor && Settings->VisualizeCalibrationColorMaterialPath.IsValid()) ||
+		(EngineShowFlags.VisualizeCalibrationGrayscale && Settings->VisualizeCalibrationGrayscaleMaterialPath.IsValid()));
+}
+
+void FCustomViewportClient::ChangeRayTracingDebugVisualizationMode(FName InName)
+{
+	SetViewMode(VMI_RayTracingDebug);
+	CurrentRayTracingDebugVisualizationMode = InName;
+}
+
+bool FCustomViewportClient::SupportsPreviewResolutionFraction() const
+{
+	// Don't do preview screen percentage for some view mode.
+	switch (GetViewMode())
+	{
+	case VMI_BrushWireframe:
+	case VMI_Wireframe:
+	case VMI_LightComplexity:
+	case VMI_LightmapDensity:
+	case VMI_LitLightmapDensity:
+	case VMI_ReflectionOverride:
+	case VMI_StationaryLightOverlap:
+	case VMI_CollisionPawn:
+	case VMI_CollisionVisibility:
+	case VMI_LODColoration:
+	case VMI_PrimitiveDistanceAccuracy:
+	case VMI_MeshUVDensityAccuracy:
+	case VMI_HLODColoration:
+	case VMI_GroupLODColoration:
+		//case VMI_VisualizeGPUSkinCache:
+		return false;
+	}
+
+	// Don't do preview screen percentage in certain cases.
+	if (EngineShowFlags.VisualizeBuffer || IsVisualizeCalibrationMaterialEnabled())
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+int32 FCustomViewportClient::GetPreviewScreenPercentage() const
+{
+	float ResolutionFraction = 1.0f;
+	if (PreviewResolutionFraction.IsSet())
+	{
+		ResolutionFraction = PreviewResolutionFraction.GetValue();
+	}
+
+	// We expose the resolution fraction derived from DPI, to not lie to the artist when screen percentage = 100%.
+	return FMath::RoundToInt(FMath::Clamp(
+		ResolutionFraction,
+		0.1f,
+		4.0f) * 100.0f);
+}
+
+void FCustomViewportClient::SetPreviewScreenPercentage(int32 PreviewScreenPercentage)
+{
+	float AutoResolutionFraction = 1.0f;
+	int32 AutoScreenPercentage = FMath::RoundToInt(FMath::Clamp(
+		AutoResolutionFraction,
+		0.1f,
+		4.0f) * 100.0f);
+
+	float NewResolutionFraction = PreviewScreenPercentage / 100.0f;
+	if (NewResolutionFraction >= 0.1f &&
+		NewResolutionFraction <= 4.0f &&
+		PreviewScreenPercentage != AutoScreenPercentage)
+	{
+		PreviewResolutionFraction = NewResolutionFraction;
+	}
+	else
+	{
+		PreviewResolutionFraction.Reset();
+	}
+}
+
+/** Convert the specified number (in cm or unreal units) into a readable string with relevant si units */
+FString FCustomViewportClient::UnrealUnitsToSiUnits(float UnrealUnits)
+{
+	// Put it in mm to start off with
+	UnrealUnits *= 10.f;
+
+	const int32 OrderOfMagnitude = UnrealUnits > 0 ? FMath::TruncToInt(FMath::LogX(10.0f, UnrealUnits)) : 0;
+
+	// Get an exponent applied to anything >= 1,000,000,000mm (1000km)
+	const int32 Exponent = (OrderOfMagnitude - 6) / 3;
+	const FString ExponentString = Exponent > 0 ? FString::Printf(TEXT("e+%d"), Exponent * 3) : TEXT("");
+
+	float ScaledNumber = UnrealUnits;
+
+	// Factor the order of magnitude into thousands and clamp it to km
+	const int32 OrderOfThousands = OrderOfMagnitude / 3;
+	if (OrderOfThousands != 0)
+	{
+		// Scale units to m or km (with the order of magnitude in 1000s)
+		ScaledNumber /= FMath::Pow(1000.f, OrderOfThousands);
+	}
+
+	// Round to 2 S.F.
+	const TCHAR* Approximation = TEXT("");
+	{
+		const int32 ScaledOrder = OrderOfMagnitude % (FMath::Max(OrderOfThousands, 1) * 3);
+		const float RoundingDivisor = FMath::Pow(10.f, ScaledOrder) / 10.f;
+		const int32 Rounded = FMath::TruncToInt(ScaledNumber / RoundingDivisor) * RoundingDivisor;
+		if (ScaledNumber - Rounded > KINDA_SMALL_NUMBER)
+		{
+			ScaledNumber = Rounded;
+			Approximation = TEXT("~");
+		}
+	}
+
+	if (OrderOfMagnitude <= 2)
+	{
+		// Always show cm not mm
+		ScaledNumber /= 10;
+	}
+
+	static const TCHAR* UnitText[] = { TEXT("cm"), TEXT("m"), TEXT("km") };
+	if (FMath::Fmod(ScaledNumber, 1.f) > KINDA_SMALL_NUMBER)
+	{
+		return FString::Printf(TEXT("%s%.1f%s%s"), Approximation, ScaledNumber, *ExponentString, UnitText[FMath::Min(OrderOfThousands, 2)]);
+	}
+	else
+	{
+		return FString::Printf(TEXT("%s%d%s%s"), Approximation, FMath::TruncToInt(ScaledNumber), *ExponentString, UnitText[FMath::Min(OrderOfThousands, 2)]);
+	}
+}
+
+
+FSceneInterface* FCustomViewportClient::GetScene() const
+{
+	UWorld* World = GetWorld();
+	if (World)
+	{
+		return World->Scene;
+	}
+
+	return NULL;
+}
+
+FLinearColor FCustomViewportClient::GetBackgroundColor() const { return FColor(55, 55, 55); }
+
+UWorld* FCustomViewportClient::GetWorld() const
+{
+	UWorld* OutWorldPtr = NULL;
+	// If we have a valid scene get its world
+	if (PreviewScene)
+	{
+		OutWorldPtr = PreviewScene->GetWorld();
+	}
+	if (OutWorldPtr == NULL)
+	{
+		OutWorldPtr = GWorld;
+	}
+	return OutWorldPtr;
+}
+
+
+void FCustomViewportClient::Draw(FViewport* InViewport, FCanvas* Canvas)
+{
+	FViewport* ViewportBackup = Viewport;
+	Viewport = InViewport ? InViewport : Viewport;
+
+	UWorld* World = GetWorld();
+
+	// Determine whether we should use world time or real time based on the scene.
+	float TimeSeconds;
+	float RealTimeSeconds;
+	float DeltaTimeSeconds;
+
+	const bool bIsRealTime = true;
+
+	if (bIsRealTime || GetScene() != World->Scene)
+	{
+		// Use time relative to start time to avoid issues with float vs double
+		TimeSeconds = FApp::GetCurrentTime() - GStartTime;
+		RealTimeSeconds = FApp::GetCurrentTime() - GStartTime;
+		DeltaTimeSeconds = FApp::GetDeltaTime();
+	}
+	else
+	{
+		TimeSeconds = World->GetTimeSeconds();
+		RealTimeSeconds = World->GetRealTimeSeconds();
+		DeltaTimeSeconds = World->GetDeltaSeconds();
+	}
+
+	// Setup a FSceneViewFamily/FSceneView for the viewport.
+	FSceneViewFamilyContext ViewFamily(FSceneViewFamily::ConstructionValues(
+		Canvas->GetRenderTarget(),
+		GetScene(),
+		EngineShowFlags)
+		.SetWorldTimes(TimeSeconds, DeltaTimeSeconds, RealTimeSeconds)
+		.SetRealtimeUpdate(bIsRealTime));
+
+	// Get DPI derived view fraction.
+	float GlobalResolutionFraction = GetDPIDerivedResolutionFraction();
+
+	// Force screen percentage show flag for High DPI.
+	ViewFamily.EngineShowFlags.ScreenPercentage = true;
+
+	//UpdateLightingShowFlags(ViewFamily.EngineShowFlags);
+
+	//ViewFamily.ExposureSettings = ExposureSettings;
+
+	//ViewFamily.LandscapeLODOverride = LandscapeLODOverride;
+
+	FSceneView* View = CalcSceneView(&ViewFamily);
+
+	ViewFamily.SetScreenPercentageInterface(new FLegacyScreenPercentageDriver(
+		ViewFamily, GlobalResolutionFraction, /* AllowPostProcessSettingsScreenPercentage = */ false));
+
+	FSlateRect SafeFrame;
+	View->CameraConstrainedViewRect = View->UnscaledViewRect;
+	//if ( CalculateEditorConstrainedViewRect(SafeFrame, Viewport) )
+	//{
+	//	View->CameraConstrainedViewRect = FIntRect(SafeFrame.Left, SafeFrame.Top, SafeFrame.Right, SafeFrame.Bottom);
+	//}
+
+	Canvas->Clear(GetBackgroundColor());
+
+	// workaround for hacky renderer code that uses GFrameNumber to decide whether to resize render targets
+	--GFrameNumber;
+
+	// Draw the 3D scene
+	GetRendererModule().BeginRenderingViewFamily(Canvas, &ViewFamily);
+
+	// Remove temporary debug lines.
+	// Possibly a hack. Lines may get added without the scene being rendered etc.
+	if (World->LineBatcher != NULL && (World->LineBatcher->BatchedLines.Num() || World->LineBatcher->BatchedPoints.Num()))
+	{
+		World->LineBatcher->Flush();
+	}
+
+	if (World->ForegroundLineBatcher != NULL && (World->ForegroundLineBatcher->BatchedLines.Num() || World->ForegroundLineBatcher->BatchedPoints.Num()))
+	{
+		World->ForegroundLineBatcher->Flush();
+	}
+
+	Viewport = ViewportBackup;
+}
+
+/** True if the window is maximized or floating */
+bool FCustomViewportClient::IsVisible() const
+{
+	bool bIsVisible = false;
+
+	if (VisibilityDelegate.IsBound())
+	{
+		// Call the visibility delegate to see if our parent viewport and layout configuration says we arevisible
+		bIsVisible = VisibilityDelegate.Execute();
+	}
+
+	return bIsVisible;
+}
+
+void FCustomViewportClient::GetViewportDimensions(FIntPoint& OutOrigin, FIntPoint& Outize)
+{
+	OutOrigin = FIntPoint(0, 0);
+	if (Viewport != NULL)
+	{
+		Outize.X = Viewport->GetSizeXY().X;
+		Outize.Y = Viewport->GetSizeXY().Y;
+	}
+	else
+	{
+		Outize = FIntPoint(0, 0);
+	}
+}
+
+void FCustomViewportClient::SetViewMode(EViewModeIndex InViewModeIndex)
+{
+	ViewModeParam = -1; // Reset value when the viewmode changes
+	ViewModeParamName = NAME_None;
+	ViewModeParamNameMap.Empty();
+
+	if (IsPerspective())
+	{
+		PerspViewModeIndex = InViewModeIndex;
+		ApplyViewMode(PerspViewModeIndex, true, EngineShowFlags);
+		bForcingUnlitForNewMap = false;
+	}
+	else
+	{
+		OrthoViewModeIndex = InViewModeIndex;
+		ApplyViewMode(OrthoViewModeIndex, false, EngineShowFlags);
+	}
+
+	Invalidate();
+}
+
+void FCustomViewportClient::SetViewModes(const EViewModeIndex InPerspViewModeIndex, const EViewModeIndex InOrthoViewModeIndex)
+{
+	PerspViewModeIndex = InPerspViewModeIndex;
+	OrthoViewModeIndex = InOrthoViewModeIndex;
+
+	if (IsPerspective())
+	{
+		ApplyViewMode(PerspViewModeIndex, true, EngineShowFlags);
+	}
+	else
+	{
+		ApplyViewMode(OrthoViewModeIndex, false, EngineShowFlags);
+	}
+
+	Invalidate();
+}
+
+void FCustomViewportClient::SetViewModeParam(int32 InViewModeParam)
+{
+	ViewModeParam = InViewModeParam;
+	FName* BoundName = ViewModeParamNameMap.Find(ViewModeParam);
+	ViewModeParamName = BoundName ? *BoundName : FName();
+
+	Invalidate();
+}
+
+bool FCustomViewportClient::IsViewModeParam(int32 InViewModeParam) const
+{
+	const FName* MappedName = ViewModeParamNameMap.Find(ViewModeParam);
+	// Check if the param and names match. The param name only gets updated on click, while the map is built at menu creation.
+	if (MappedName)
+	{
+		return ViewModeParam == InViewModeParam && ViewModeParamName == *MappedName;
+	}
+	else
+	{
+		return ViewModeParam == InViewModeParam && ViewModeParamName == NAME_None;
+	}
+}
+
+void FCustomViewportClient::Invalidate(bool bInvalidateChildViews, bool bInvalidateHitProxies)
+{
+	if (Viewport)
+	{
+		if (bInvalidateHitProxies)
+		{
+			// Invalidate hit proxies and display pixels.
+			Viewport->Invalidate();
+		}
+		else
+		{
+			// Invalidate only display pixels.
+			Viewport->InvalidateDisplay();
+		}
+	}
+}
+
+void FCustomViewportClient::SetGameView(bool bGameViewEnable)
+{
+	// backup this state as we want to preserve it
+	bool bCompositeEditorPrimitives = EngineShowFlags.CompositeEditorPrimitives;
+
+	// defaults
+	FEngineShowFlags GameFlags(ESFIM_Game);
+	FEngineShowFlags EditorFlags(ESFIM_Editor);
+	{
+		// likely we can take the existing state
+		if (EngineShowFlags.Game)
+		{
+			GameFlags = EngineShowFlags;
+			EditorFlags = LastEngineShowFlags;
+		}
+		else if (LastEngineShowFlags.Game)
+		{
+			GameFlags = LastEngineShowFlags;
+			EditorFlags = EngineShowFlags;
+		}
+	}
+
+	// toggle between the game and engine flags
+	if (bGameViewEnable)
+	{
+		EngineShowFlags = GameFlags;
+		LastEngineShowFlags = EditorFlags;
+	}
+	else
+	{
+		EngineShowFlags = EditorFlags;
+		LastEngineShowFlags = GameFlags;
+	}
+
+	// maintain this state
+	EngineShowFlags.SetCompositeEditorPrimitives(bCompositeEditorPrimitives);
+	LastEngineShowFlags.SetCompositeEditorPrimitives(bCompositeEditorPrimitives);
+
+	//reset game engine show flags that may have been turned on by making a selection in game view
+	if (bGameViewEnable)
+	{
+		EngineShowFlags.SetModeWidgets(false);
+		EngineShowFlags.SetSelection(false);
+	}
+
+	EngineShowFlags.SetSelectionOutline(false);
+
+	ApplyViewMode(GetViewMode(), IsPerspective(), EngineShowFlags);
+
+	bInGameViewMode = bGameViewEnable;
+
+	Invalidate();
+}
+
+float FCustomViewportClient::UpdateViewportClientWindowDPIScale() const
+{
+	float DPIScale = 1.f;
+	if (ViewportWidget.IsValid())
+	{
+		TSharedPtr<SWindow> WidgetWindow = FSlateApplication::Get().FindWidgetWindow(ViewportWidget.Pin().ToSharedRef());
+		if (WidgetWindow.IsValid())
+		{
+			DPIScale = WidgetWindow->GetNativeWindow()->GetDPIScaleFactor();
+		}
+	}
+
+	return DPIScale;
+}
+
+//------------------------------------------------------
+// FViewportRenderScheduler
+//------------------------------------------------------
+
+static TAutoConsoleVariable<int32> CVarViewportWidgetMaxViewsPerFrame(
+	TEXT("r.ViewportWidget.MaxViewsPerFrame"),
+	0,
+	TEXT("Maximum number of viewport widgets rendered per frame, focused and hovered ones included. 0 means no limit."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarViewportWidgetGPUBudgetMs(
+	TEXT("r.ViewportWidget.GPUBudgetMs"),
+	0.f,
+	TEXT("GPU frame time in milliseconds above which viewport widgets that are neither focused nor hovered get throttled. 0 disables the GPU budget."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarViewportWidgetBackgroundFrameInterval(
+	TEXT("r.ViewportWidget.BackgroundFrameInterval"),
+	1,
+	TEXT("Viewport widgets that are neither focused nor hovered render at most once every N frames."),
+	ECVF_Default);
+
+FViewportRenderScheduler::FViewportRenderScheduler()
+	: CurrentFrame(0)
+	, FrameBudget(MAX_int32)
+	, NumReservedSlots(0)
+	, NumRenderedThisFrame(0)
+	, NumRenderedLastFrame(0)
+	, GPUViewBudget(-1.f)
+{}
+
+void FViewportRenderScheduler::Register(SViewportWidget* Viewport)
+{
+	FScheduledViewport& scheduled = Viewports.AddDefaulted_GetRef();
+	scheduled.Viewport = Viewport;
+	scheduled.LastRenderFrame = 0;
+	scheduled.bWantsRender = false;
+	scheduled.bReserved = false;
+	scheduled.bHighPriority = false;
+}
+
+void FViewportRenderScheduler::Unregister(SViewportWidget* Viewport)
+{
+	const int32 index = Viewports.IndexOfByPredicate([Viewport](const FScheduledViewport& scheduled) { return scheduled.Viewport == Viewport; });
+	if (index != INDEX_NONE)
+	{
+		if (Viewports[index].bReserved)
+		{
+			NumReservedSlots--;
+		}
+
+		Viewports.RemoveAtSwap(index);
+	}
+}
+
+bool FViewportRenderScheduler::RequestRender(SViewportWidget* Viewport, bool bHighPriority)
+{
+	if (GFrameCounter != CurrentFrame)
+	{
+		BeginFrame();
+	}
+
+	FScheduledViewport* scheduled = Viewports.FindByPredicate([Viewport](const FScheduledViewport& item) { return item.Viewport == Viewport; });
+	if (!scheduled)
+	{
+		return true;
+	}
+
+	scheduled->bWantsRender = true;
+	scheduled->bHighPriority = bHighPriority;
+
+	const uint64 frameInterval = FMath::Max(CVarViewportWidgetBackgroundFrameInterval.GetValueOnGameThread(), 1);
+
+	bool bAllowed = false;
+	if (bHighPriority)
+	{
+		bAllowed = true;
+	}
+	else if (scheduled->bReserved)
+	{
+		bAllowed = true;
+	}
+	else if (CurrentFrame - scheduled->LastRenderFrame >= frameInterval)
+	{
+		bAllowed = NumRenderedThisFrame + NumReservedSlots < FrameBudget;
+	}
+
+	if (scheduled->bReserved)
+	{
+		scheduled->bReserved = false;
+		NumReservedSlots--;
+	}
+
+	if (bAllowed)
+	{
+		scheduled->LastRenderFrame = CurrentFrame;
+		NumRenderedThisFrame++;
+	}
+
+	return bAllowed;
+}
+
+void FViewportRenderScheduler::BeginFrame()
+{
+	CSV_CUSTOM_STAT(ViewportWidget, Viewports, Viewports.Num(), ECsvCustomStatOp::Set);
+
+	CurrentFrame = GFrameCounter;
+	NumRenderedLastFrame = NumRenderedThisFrame;
+	NumRenderedThisFrame = 0;
+	NumReservedSlots = 0;
+	FrameBudget = ComputeFrameBudget();
+
+	const uint64 frameInterval = FMath::Max(CVarViewportWidgetBackgroundFrameInterval.GetValueOnGameThread(), 1);
+
+	int32 numHighPriority = 0;
+	TArray<FScheduledViewport*, TInlineAllocator<32>> waiting;
+	for (FScheduledViewport& scheduled : Viewports)
+	{
+		if (scheduled.bWantsRender)
+		{
+			if (scheduled.bHighPriority)
+			{
+				numHighPriority++;
+			}
+			else if (scheduled.LastRenderFrame != CurrentFrame - 1 && CurrentFrame - scheduled.LastRenderFrame >= frameInterval)
+			{
+				waiting.Add(&scheduled);
+			}
+		}
+
+		scheduled.bWantsRender = false;
+		scheduled.bReserved = false;
+	}
+
+	// Focused and hovered viewports will ask again this frame, the remaining slots go to the ones that waited the longest
+	waiting.Sort([](const FScheduledViewport& A, const FScheduledViewport& B) { return A.LastRenderFrame < B.LastRenderFrame; });
+
+	const int32 numSlots = FrameBudget == MAX_int32 ? waiting.Num() : FMath::Clamp(FrameBudget - numHighPriority, 0, waiting.Num());
+	for (int32 i = 0; i < numSlots; i++)
+	{
+		waiting[i]->bReserved = true;
+		NumReservedSlots++;
+	}
+}
+
+int32 FViewportRenderScheduler::ComputeFrameBudget()
+{
+	const int32 maxViewsPerFrame = CVarViewportWidgetMaxViewsPerFrame.GetValueOnGameThread();
+	int32 budget = maxViewsPerFrame > 0 ? maxViewsPerFrame : MAX_int32;
+
+	const float gpuBudgetMs = CVarViewportWidgetGPUBudgetMs.GetValueOnGameThread();
+	if (gpuBudgetMs > 0.f)
+	{
+		// Set from startup, the budget starts from every viewport like when the GPU budget is turned on later
+		if (GPUViewBudget < 0.f)
+		{
+			GPUViewBudget = (float)FMath::Min(budget, FMath::Max(Viewports.Num(), 1));
+		}
+
+		// The GPU time is a few frames late, so back off multiplicatively and recover slowly to avoid oscillating
+		const float gpuFrameMs = FPlatformTime::ToMilliseconds(RHIGetGPUFrameCycles());
+		if (gpuFrameMs > gpuBudgetMs)
+		{
+			GPUViewBudget = FMath::Max(1.f, FMath::Min(GPUViewBudget, (float)NumRenderedLastFrame) * 0.75f);
+		}
+		else
+		{
+			GPUViewBudget += 0.25f;
+		}
+
+		GPUViewBudget = FMath::Min(GPUViewBudget, (float)FMath::Min(budget, FMath::Max(Viewports.Num(), 1)));
+		budget = FMath::Min(budget, FMath::FloorToInt(GPUViewBudget));
+	}
+	else
+	{
+		GPUViewBudget = (float)FMath::Min(budget, Viewports.Num());
+	}
+
+	return budget;
+}
+
+//------------------------------------------------------
+// FViewportThumbnailRenderer
+//------------------------------------------------------
+
+FViewportThumbnailRenderer::FViewportThumbnailRenderer()
+{
+}
+
+FViewportThumbnailRenderer::~FViewportThumbnailRenderer()
+{
+	ReleaseScene();
+}
+
+void FViewportThumbnailRenderer::ReleaseScene()
+{
+	Client.Reset();
+	PreviewScene.Reset();
+}
+
+UTextureRenderTarget2D* FViewportThumbnailRenderer::RenderAtlas(const TArray<FViewportWidgetEntry>& Entries, const FViewportThumbnailCamera& Camera, int32 CellSize, TArray<FBox2D>& OutUVRects,
+	UTextureRenderTarget2D* RenderTarget, FName QualityProfile)
+{
+	OutUVRects.Reset();
+
+	if (Entries.Num() == 0 || CellSize <= 0)
+	{
+		return nullptr;
+	}
+
+	// The world is created on first use and kept, so later atlases reuse it and its pooled actors
+	if (!PreviewScene.IsValid())
+	{
+		// The atlas is rendered once, with no later frame to show the mips a streaming view would ask for
+		PreviewScene = MakeShareable(new FCustomPreviewScene(FCustomPreviewScene::GetDefaultConstructionValues().SetForceMipsResident(true)));
+		Client = MakeShareable(new FCustomUMGViewportClient(PreviewScene.Get()));
+	}
+
+	UWorld* world = PreviewScene->GetWorld();
+
+	const int32 numColumns = FMath::CeilToInt(FMath::Sqrt((float)Entries.Num()));
+	const int32 numRows = FMath::DivideAndRoundUp(Entries.Num(), numColumns);
+	const FIntPoint atlasSize(numColumns * CellSize, numRows * CellSize);
+
+	if (!RenderTarget)
+	{
+		RenderTarget = NewObject<UTextureRenderTarget2D>(GetTransientPackage());
+	}
+
+	RenderTarget->ClearColor = Camera.BackgroundColor;
+	if (RenderTarget->SizeX != atlasSize.X || RenderTarget->SizeY != atlasSize.Y || !RenderTarget->GameThread_GetRenderTargetResource())
+	{
+		RenderTarget->InitCustomFormat(atlasSize.X, atlasSize.Y, PF_B8G8R8A8, false);
+		RenderTarget->UpdateResourceImmediate(true);
+	}
+
+	// The atlas is rendered in one go, so the capture cannot wait for the budget of a later frame
+	PreviewScene->RequestCapture();
+	PreviewScene->UpdatePendingCapture(/* bIgnoreBudget = */ true);
+
+	Client->SetQualityProfile(UViewportWidgetSettings::FindQualityProfile(QualityProfile.IsNone() ? FName(TEXT("Thumbnail")) : QualityProfile));
+	Client->SetViewLocation(Camera.ViewTransform.GetLocation());
+	Client->SetViewRotation(Camera.ViewTransform.Rotator());
+	Client->SetViewFOV(Camera.FOV);
+	Client->SetBackgroundColor(Camera.BackgroundColor);
+
+	// Every entry is spawned at its own transform; the cells keep them apart with show only lists
+	TArray<AActor*> actors;
+	actors.Reserve(Entries.Num());
+
+	for (const FViewportWidgetEntry& entry : Entries)
+	{
+		AActor* actor = nullptr;
+		if (UClass* actorClass = entry.ActorClassPtr.LoadSynchronous())
+		{
+			EPreviewActorOrigin origin = EPreviewActorOrigin::Spawned;
+			actor = PreviewScene->SpawnPooledActor(actorClass, entry.SpawnTransform, origin);
+		}
+
+		actors.Add(actor);
+	}
+
+	// Reused actors were unhidden this frame, their render state has to be up to date before the views are set up
+	world->SendAllEndOfFrameUpdates();
+
+	FTextureRenderTargetResource* renderTargetResource = RenderTarget->GameThread_GetRenderTargetResource();
+
+	FCanvas canvas(renderTargetResource, nullptr, world, world->FeatureLevel);
+	canvas.Clear(Camera.BackgroundColor);
+
+	const float timeSeconds = FApp::GetCurrentTime() - GStartTime;
+
+	FSceneViewFamilyContext viewFamily(FSceneViewFamily::ConstructionValues(
+		renderTargetResource,
+		PreviewScene->GetScene(),
+		Client->GetViewFamilyShowFlags())
+		.SetWorldTimes(timeSeconds, FApp::GetDeltaTime(), timeSeconds));
+
+	// A one-shot view has no history to blur or adapt from
+	viewFamily.EngineShowFlags.MotionBlur = 0;
+
+	for (int32 i = 0; i < actors.Num(); i++)
+	{
+		const FIntPoint cellMin((i % numColumns) * CellSize, (i / numColumns) * CellSize);
+
+		OutUVRects.Add(FBox2D(
+			FVector2D(cellMin.X / (float)atlasSize.X, cellMin.Y / (float)atlasSize.Y),
+			FVector2D((cellMin.X + CellSize) / (float)atlasSize.X, (cellMin.Y + CellSize) / (float)atlasSize.Y)));
+
+		if (!actors[i])
+		{
+			continue;
+		}
+
+		TSet<FPrimitiveComponentId> showOnlyPrimitives;
+
+		TInlineComponentArray<UPrimitiveComponent*> primitiveComponents(actors[i]);
+		for (const UPrimitiveComponent* primitiveComponent : primitiveComponents)
+		{
+			showOnlyPrimitives.Add(primitiveComponent->ComponentId);
+		}
+
+		Client->SetShowOnlyPrimitives(showOnlyPrimitives);
+		Client->CalcSceneView(&viewFamily, FIntRect(cellMin, cellMin + FIntPoint(CellSize, CellSize)));
+	}
+
+	Client->SetShowOnlyPrimitives(TOptional<TSet<FPrimitiveComponentId>>());
+
+	if (viewFamily.Views.Num() > 0)
+	{
+		viewFamily.SetScreenPercentageInterface(new FLegacyScreenPercentageDriver(
+			viewFamily, 1.f, /* AllowPostProcessSettingsScreenPercentage = */ false));
+
+		GetRendererModule().BeginRenderingViewFamily(&canvas, &viewFamily);
+	}
+
+	canvas.Flush_GameThread();
+
+	// The render commands above are queued before the ones hiding or destroying the actors, so the atlas still sees them
+	for (AActor* actor : actors)
+	{
+		if (actor)
+		{
+			PreviewScene->ReleasePooledActor(actor);
+		}
+	}
+
+	return RenderTarget;
+}
+
+//------------------------------------------------------
+// UViewportOffscreenRenderer
+//------------------------------------------------------
+
+UViewportOffscreenRenderer* UViewportOffscreenRenderer::CreateOffscreenRenderer()
+{
+	return NewObject<UViewportOffscreenRenderer>(GetTransientPackage());
+}
+
+void UViewportOffscreenRenderer::SetEntries(const TArray<FViewportWidgetEntry>& InEntries)
+{
+	Entries = InEntries;
+
+	// Without a world yet, the entries are spawned on the first render
+	if (PreviewScene.IsValid())
+	{
+		ReleaseEntryActors();
+		SpawnEntryActors();
+	}
+}
+
+UTextureRenderTarget2D* UViewportOffscreenRenderer::Render(const FViewportThumbnailCamera& Camera, FIntPoint Size, UTextureRenderTarget2D* RenderTarget, float WorldDeltaSeconds)
+{
+	if (Size.X <= 0 || Size.Y <= 0)
+	{
+		return nullptr;
+	}
+
+	EnsurePreviewScene();
+
+	UWorld* world = PreviewScene->GetWorld();
+
+	if (!RenderTarget)
+	{
+		RenderTarget = NewObject<UTextureRenderTarget2D>(GetTransientPackage());
+	}
+
+	RenderTarget->ClearColor = Camera.BackgroundColor;
+	if (RenderTarget->SizeX != Size.X || RenderTarget->SizeY != Size.Y || !RenderTarget->GameThread_GetRenderTargetResource())
+	{
+		RenderTarget->InitCustomFormat(Size.X, Size.Y, PF_B8G8R8A8, false);
+		RenderTarget->UpdateResourceImmediate(true);
+	}
+
+	PreviewScene->SetLightBrightness(LightBrightness);
+	PreviewScene->SetLightDirection(LightDirection);
+	PreviewScene->SetSkyBrightness(SkyBrightness);
+	// Bulk renders can all run in one frame, so the capture cannot wait for the budget of a later one
+	PreviewScene->RequestCapture();
+	PreviewScene->UpdatePendingCapture(/* bIgnoreBudget = */ true);
+
+	Client->SetQualityProfile(UViewportWidgetSettings::FindQualityProfile(QualityProfile));
+	Client->SetViewLocation(Camera.ViewTransform.GetLocation());
+	Client->SetViewRotation(Camera.ViewTransform.Rotator());
+	Client->SetViewFOV(Camera.FOV);
+	Client->SetBackgroundColor(Camera.BackgroundColor);
+
+	// Ticking with no time still dispatches BeginPlay and updates the pose of the entries
+	Client->Tick(FMath::Max(WorldDeltaSeconds, 0.f));
+
+	// Spawned and reused actors have to be in the render scene before the view is set up
+	world->SendAllEndOfFrameUpdates();
+
+	FCanvas canvas(RenderTarget->GameThread_GetRenderTargetResource(), nullptr, world, world->FeatureLevel);
+	Client->DrawOffscreen(&canvas);
+	canvas.Flush_GameThread();
+
+	return RenderTarget;
 }
 
-void FCustomViewportClient::HandleToggleShowFlag(FEngineShowFlags::EShowFlag EngineShowFlagIndex)
+void UViewportOffscreenRenderer::ReleaseScene()
 {
-	const bool bOldState = EngineShowFlags.GetSingleFlag(EngineShowFlagIndex);
-	EngineShowFlags.SetSingleFlag(EngineShowFlagIndex, !bOldState);
+	ReleaseEntryActors();
 
-	// Invalidate clients which aren't real-time so we see the changes.
-	Invalidate();
+	Client.Reset();
+	PreviewScene.Reset();
 }
 
-
-bool FCustomViewportClient::IsVisualizeCalibrationMaterialEnabled() const
+void UViewportOffscreenRenderer::BeginDestroy()
 {
-	// Get the list of requested buffers from the console
-	const URendererSettings* Settings = GetDefault<URendererSettings>();
-	check(Settings);
+	ReleaseScene();
 
-	return ((EngineShowFlags.VisualizeCalibrationCustom && Settings->VisualizeCalibrationCustomMaterialPath.IsValid()) ||
-		(EngineShowFlags.VisualizeCalibrationColor && Settings->VisualizeCalibrationColorMaterialPath.IsValid()) ||
-		(EngineShowFlags.VisualizeCalibrationGrayscale && Settings->VisualizeCalibrationGrayscaleMaterialPath.IsValid()));
+	Super::BeginDestroy();
 }
 
-void FCustomViewportClient::ChangeRayTracingDebugVisualizationMode(FName InName)
+void UViewportOffscreenRenderer::EnsurePreviewScene()
 {
-	SetViewMode(VMI_RayTracingDebug);
-	CurrentRayTracingDebugVisualizationMode = InName;
+	if (PreviewScene.IsValid())
+	{
+		return;
+	}
+
+	// An offscreen render has no later frame to show the mips a streaming view would ask for
+	PreviewScene = MakeShareable(new FCustomPreviewScene(FCustomPreviewScene::GetConstructionValues(WorldProfile).SetForceMipsResident(true), WorldProfile));
+	Client = MakeShareable(new FCustomUMGViewportClient(PreviewScene.Get()));
+
+	SpawnEntryActors();
 }
 
-bool FCustomViewportClient::SupportsPreviewResolutionFraction() const
+void UViewportOffscreenRenderer::SpawnEntryActors()
 {
-	// Don't do preview screen percentage for some view mode.
-	switch (GetViewMode())
+	EntryActors.Reserve(Entries.Num());
+
+	for (const FViewportWidgetEntry& entry : Entries)
 	{
-	case VMI_BrushWireframe:
-	case VMI_Wireframe:
-	case VMI_LightComplexity:
-	case VMI_LightmapDensity:
-	case VMI_LitLightmapDensity:
-	case VMI_ReflectionOverride:
-	case VMI_StationaryLightOverlap:
-	case VMI_CollisionPawn:
-	case VMI_CollisionVisibility:
-	case VMI_LODColoration:
-	case VMI_PrimitiveDistanceAccuracy:
-	case VMI_MeshUVDensityAccuracy:
-	case VMI_HLODColoration:
-	case VMI_GroupLODColoration:
-		//case VMI_VisualizeGPUSkinCache:
-		return false;
+		if (UClass* actorClass = entry.ActorClassPtr.LoadSynchronous())
+		{
+			EPreviewActorOrigin origin = EPreviewActorOrigin::Spawned;
+			if (AActor* actor = PreviewScene->SpawnPooledActor(actorClass, entry.SpawnTransform, origin))
+			{
+				EntryActors.Add(actor);
+			}
+		}
 	}
+}
 
-	// Don't do preview screen percentage in certain cases.
-	if (EngineShowFlags.VisualizeBuffer || IsVisualizeCalibrationMaterialEnabled())
+void UViewportOffscreenRenderer::ReleaseEntryActors()
+{
+	if (PreviewScene.IsValid())
 	{
-		return false;
+		for (const TWeakObjectPtr<AActor>& actor : EntryActors)
+		{
+			if (actor.IsValid())
+			{
+				PreviewScene->ReleasePooledActor(actor.Get());
+			}
+		}
 	}
 
-	return true;
+	EntryActors.Reset();
 }
 
+//------------------------------------------------------
+// FViewportThumbnailCache
+//------------------------------------------------------
+
+static TAutoConsoleVariable<int32> CVarViewportWidgetThumbnailCacheSizeMB(
+	TEXT("r.ViewportWidget.ThumbnailCacheSizeMB"),
+	64,
+	TEXT("Size of the persistent viewport thumbnail cache in megabytes of compressed images. The least recently used images are evicted first."),
+	ECVF_Default);
 
-int32 FCustomViewportClient::GetPreviewScreenPercentage() const
+namespace ViewportThumbnailCacheFile
 {
-	float ResolutionFraction = 1.0f;
-	if (PreviewResolutionFraction.IsSet())
-	{
-		ResolutionFraction = PreviewResolutionFraction.GetValue();
-	}
+	const uint32 Magic = 0x43545756; // "VWTC"
+	const uint32 Version = 1;
 
-	// We expose the resolution fraction derived from DPI, to not lie to the artist when screen percentage = 100%.
-	return FMath::RoundToInt(FMath::Clamp(
-		ResolutionFraction,
-		0.1f,
-		4.0f) * 100.0f);
+	/** Magic, version and record count */
+	const int64 HeaderSize = sizeof(uint32) + sizeof(uint32) + sizeof(int32);
+
+	/** Key, offset, compressed size, width, height and last use */
+	const int64 IndexRecordSize = sizeof(uint64) + sizeof(int64) + sizeof(int32) + sizeof(int32) + sizeof(int32) + sizeof(int64);
+
+	/** Largest width or height of a cached image, a record claiming more is corrupt */
+	const int32 MaxImageSize = 16384;
 }
 
-void FCustomViewportClient::SetPreviewScreenPercentage(int32 PreviewScreenPercentage)
+FViewportThumbnailCache::FViewportThumbnailCache()
+	: TotalCompressedSize(0)
+	, bOpened(false)
+	, bDirty(false)
 {
-	float AutoResolutionFraction = 1.0f;
-	int32 AutoScreenPercentage = FMath::RoundToInt(FMath::Clamp(
-		AutoResolutionFraction,
-		0.1f,
-		4.0f) * 100.0f);
+}
 
-	float NewResolutionFraction = PreviewScreenPercentage / 100.0f;
-	if (NewResolutionFraction >= 0.1f &&
-		NewResolutionFraction <= 4.0f &&
-		PreviewScreenPercentage != AutoScreenPercentage)
+FViewportThumbnailCache::~FViewportThumbnailCache()
+{
+	CloseMapping();
+}
+
+FString FViewportThumbnailCache::GetCacheFilename()
+{
+	return FPaths::ProjectSavedDir() / TEXT("ViewportWidget") / TEXT("ThumbnailCache.bin");
+}
+
+void FViewportThumbnailCache::Open()
+{
+	if (bOpened)
 	{
-		PreviewResolutionFraction = NewResolutionFraction;
+		return;
 	}
-	else
+
+	bOpened = true;
+
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*GetCacheFilename()));
+	if (!MappedFile.IsValid() || MappedFile->GetFileSize() < ViewportThumbnailCacheFile::HeaderSize)
 	{
-		PreviewResolutionFraction.Reset();
+		CloseMapping();
+		return;
 	}
-}
-
-/** Convert the specified number (in cm or unreal units) into a readable string with relevant si units */
-FString FCustomViewportClient::UnrealUnitsToSiUnits(float UnrealUnits)
-{
-	// Put it in mm to start off with
-	UnrealUnits *= 10.f;
 
-	const int32 OrderOfMagnitude = UnrealUnits > 0 ? FMath::TruncToInt(FMath::LogX(10.0f, UnrealUnits)) : 0;
+	MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+	if (!MappedRegion.IsValid())
+	{
+		CloseMapping();
+		return;
+	}
 
-	// Get an exponent applied to anything >= 1,000,000,000mm (1000km)
-	const int32 Exponent = (OrderOfMagnitude - 6) / 3;
-	const FString ExponentString = Exponent > 0 ? FString::Printf(TEXT("e+%d"), Exponent * 3) : TEXT("");
+	const uint8* data = MappedRegion->GetMappedPtr();
+	const int64 dataSize = MappedRegion->GetMappedSize();
 
-	float ScaledNumber = UnrealUnits;
+	uint32 magic = 0;
+	uint32 version = 0;
+	int32 numRecords = 0;
+	FMemory::Memcpy(&magic, data, sizeof(uint32));
+	FMemory::Memcpy(&version, data + sizeof(uint32), sizeof(uint32));
+	FMemory::Memcpy(&numRecords, data + 2 * sizeof(uint32), sizeof(int32));
 
-	// Factor the order of magnitude into thousands and clamp it to km
-	const int32 OrderOfThousands = OrderOfMagnitude / 3;
-	if (OrderOfThousands != 0)
+	// A file from another version, or a truncated one, is discarded and rewritten on the next flush
+	if (magic != ViewportThumbnailCacheFile::Magic || version != ViewportThumbnailCacheFile::Version || numRecords < 0
+		|| ViewportThumbnailCacheFile::HeaderSize + numRecords * ViewportThumbnailCacheFile::IndexRecordSize > dataSize)
 	{
-		// Scale units to m or km (with the order of magnitude in 1000s)
-		ScaledNumber /= FMath::Pow(1000.f, OrderOfThousands);
+		CloseMapping();
+		bDirty = true;
+		return;
 	}
 
-	// Round to 2 S.F.
-	const TCHAR* Approximation = TEXT("");
+	const uint8* indexRecord = data + ViewportThumbnailCacheFile::HeaderSize;
+	for (int32 i = 0; i < numRecords; i++, indexRecord += ViewportThumbnailCacheFile::IndexRecordSize)
 	{
-		const int32 ScaledOrder = OrderOfMagnitude % (FMath::Max(OrderOfThousands, 1) * 3);
-		const float RoundingDivisor = FMath::Pow(10.f, ScaledOrder) / 10.f;
-		const int32 Rounded = FMath::TruncToInt(ScaledNumber / RoundingDivisor) * RoundingDivisor;
-		if (ScaledNumber - Rounded > KINDA_SMALL_NUMBER)
+		uint64 key = 0;
+		FRecord record;
+		FMemory::Memcpy(&key, indexRecord, sizeof(uint64));
+		FMemory::Memcpy(&record.MappedOffset, indexRecord + 8, sizeof(int64));
+		FMemory::Memcpy(&record.CompressedSize, indexRecord + 16, sizeof(int32));
+		FMemory::Memcpy(&record.Size.X, indexRecord + 20, sizeof(int32));
+		FMemory::Memcpy(&record.Size.Y, indexRecord + 24, sizeof(int32));
+		FMemory::Memcpy(&record.LastUsed, indexRecord + 28, sizeof(int64));
+
+		const bool bValidSize = record.Size.X > 0 && record.Size.Y > 0
+			&& record.Size.X <= ViewportThumbnailCacheFile::MaxImageSize && record.Size.Y <= ViewportThumbnailCacheFile::MaxImageSize;
+
+		if (bValidSize && record.MappedOffset >= 0 && record.CompressedSize > 0 && record.MappedOffset + record.CompressedSize <= dataSize)
 		{
-			ScaledNumber = Rounded;
-			Approximation = TEXT("~");
+			TotalCompressedSize += record.CompressedSize;
+			Records.Add(key, MoveTemp(record));
 		}
 	}
+}
 
-	if (OrderOfMagnitude <= 2)
+void FViewportThumbnailCache::CloseMapping()
+{
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+const uint8* FViewportThumbnailCache::GetCompressedData(const FRecord& Record) const
+{
+	if (Record.MappedOffset == INDEX_NONE)
 	{
-		// Always show cm not mm
-		ScaledNumber /= 10;
+		return Record.CompressedData.GetData();
 	}
 
-	static const TCHAR* UnitText[] = { TEXT("cm"), TEXT("m"), TEXT("km") };
-	if (FMath::Fmod(ScaledNumber, 1.f) > KINDA_SMALL_NUMBER)
+	return MappedRegion.IsValid() ? MappedRegion->GetMappedPtr() + Record.MappedOffset : nullptr;
+}
+
+bool FViewportThumbnailCache::Contains(uint64 Key)
+{
+	Open();
+
+	return Records.Contains(Key);
+}
+
+bool FViewportThumbnailCache::Find(uint64 Key, FIntPoint& OutSize, TArray<FColor>& OutPixels)
+{
+	Open();
+
+	FRecord* record = Records.Find(Key);
+	const uint8* compressedData = record ? GetCompressedData(*record) : nullptr;
+	if (!compressedData)
 	{
-		return FString::Printf(TEXT("%s%.1f%s%s"), Approximation, ScaledNumber, *ExponentString, UnitText[FMath::Min(OrderOfThousands, 2)]);
+		return false;
 	}
-	else
+
+	OutPixels.SetNumUninitialized(record->Size.X * record->Size.Y);
+	if (!FCompression::UncompressMemory(NAME_Zlib, OutPixels.GetData(), OutPixels.Num() * sizeof(FColor), compressedData, record->CompressedSize))
 	{
-		return FString::Printf(TEXT("%s%d%s%s"), Approximation, FMath::TruncToInt(ScaledNumber), *ExponentString, UnitText[FMath::Min(OrderOfThousands, 2)]);
+		OutPixels.Reset();
+		return false;
 	}
-}
 
+	OutSize = record->Size;
 
-FSceneInterface* FCustomViewportClient::GetScene() const
+	// The use is persisted, or the eviction order of the next session would not know about it
+	record->LastUsed = FDateTime::UtcNow().GetTicks();
+	bDirty = true;
+
+	return true;
+}
+
+void FViewportThumbnailCache::Store(uint64 Key, const FIntPoint& Size, const TArray<FColor>& Pixels)
 {
-	UWorld* World = GetWorld();
-	if (World)
+	if (Size.X <= 0 || Size.Y <= 0 || Size.X > ViewportThumbnailCacheFile::MaxImageSize || Size.Y > ViewportThumbnailCacheFile::MaxImageSize
+		|| Pixels.Num() != Size.X * Size.Y)
 	{
-		return World->Scene;
+		return;
 	}
 
-	return NULL;
-}
+	Open();
 
-FLinearColor FCustomViewportClient::GetBackgroundColor() const { return FColor(55, 55, 55); }
+	const int32 uncompressedSize = Pixels.Num() * sizeof(FColor);
 
-UWorld* FCustomViewportClient::GetWorld() const
-{
-	UWorld* OutWorldPtr = NULL;
-	// If we have a valid scene get its world
-	if (PreviewScene)
+	int32 compressedSize = FCompression::CompressMemoryBound(NAME_Zlib, uncompressedSize);
+	TArray<uint8> compressedData;
+	compressedData.SetNumUninitialized(compressedSize);
+	if (!FCompression::CompressMemory(NAME_Zlib, compressedData.GetData(), compressedSize, Pixels.GetData(), uncompressedSize))
 	{
-		OutWorldPtr = PreviewScene->GetWorld();
+		return;
 	}
-	if (OutWorldPtr == NULL)
+	compressedData.SetNum(compressedSize);
+
+	if (const FRecord* previousRecord = Records.Find(Key))
 	{
-		OutWorldPtr = GWorld;
+		TotalCompressedSize -= previousRecord->CompressedSize;
 	}
-	return OutWorldPtr;
-}
 
+	FRecord& record = Records.Add(Key);
+	record.Size = Size;
+	record.LastUsed = FDateTime::UtcNow().GetTicks();
+	record.MappedOffset = INDEX_NONE;
+	record.CompressedSize = compressedSize;
+	record.CompressedData = MoveTemp(compressedData);
 
-void FCustomViewportClient::Draw(FViewport* InViewport, FCanvas* Canvas)
-{
-	FViewport* ViewportBackup = Viewport;
-	Viewport = InViewport ? InViewport : Viewport;
+	TotalCompressedSize += compressedSize;
+	bDirty = true;
 
-	UWorld* World = GetWorld();
+	EvictToBudget();
+}
 
-	// Determine whether we should use world time or real time based on the scene.
-	float TimeSeconds;
-	float RealTimeSeconds;
-	float DeltaTimeSeconds;
+void FViewportThumbnailCache::EvictToBudget()
+{
+	const int64 budget = (int64)FMath::Max(CVarViewportWidgetThumbnailCacheSizeMB.GetValueOnGameThread(), 0) * 1024 * 1024;
+	if (TotalCompressedSize <= budget)
+	{
+		return;
+	}
 
-	const bool bIsRealTime = true;
+	Records.ValueSort([](const FRecord& A, const FRecord& B) { return A.LastUsed < B.LastUsed; });
 
-	if (bIsRealTime || GetScene() != World->Scene)
+	for (auto It = Records.CreateIterator(); It && TotalCompressedSize > budget; ++It)
 	{
-		// Use time relative to start time to avoid issues with float vs double
-		TimeSeconds = FApp::GetCurrentTime() - GStartTime;
-		RealTimeSeconds = FApp::GetCurrentTime() - GStartTime;
-		DeltaTimeSeconds = FApp::GetDeltaTime();
+		TotalCompressedSize -= It.Value().CompressedSize;
+		It.RemoveCurrent();
 	}
-	else
+
+	bDirty = true;
+}
+
+void FViewportThumbnailCache::Flush()
+{
+	if (!bDirty)
 	{
-		TimeSeconds = World->GetTimeSeconds();
-		RealTimeSeconds = World->GetRealTimeSeconds();
-		DeltaTimeSeconds = World->GetDeltaSeconds();
+		return;
 	}
 
-	// Setup a FSceneViewFamily/FSceneView for the viewport.
-	FSceneViewFamilyContext ViewFamily(FSceneViewFamily::ConstructionValues(
-		Canvas->GetRenderTarget(),
-		GetScene(),
-		EngineShowFlags)
-		.SetWorldTimes(TimeSeconds, DeltaTimeSeconds, RealTimeSeconds)
-		.SetRealtimeUpdate(bIsRealTime));
+	EvictToBudget();
 
-	// Get DPI derived view fraction.
-	float GlobalResolutionFraction = GetDPIDerivedResolutionFraction();
+	// Records of a mapping that could not be made again after the last flush have nothing left to write
+	for (auto It = Records.CreateIterator(); It; ++It)
+	{
+		if (!GetCompressedData(It.Value()))
+		{
+			TotalCompressedSize -= It.Value().CompressedSize;
+			It.RemoveCurrent();
+		}
+	}
 
-	// Force screen percentage show flag for High DPI.
-	ViewFamily.EngineShowFlags.ScreenPercentage = true;
+	const FString filename = GetCacheFilename();
+	const FString tempFilename = filename + TEXT(".tmp");
 
-	//UpdateLightingShowFlags(ViewFamily.EngineShowFlags);
+	TUniquePtr<FArchive> writer(IFileManager::Get().CreateFileWriter(*tempFilename));
+	if (!writer.IsValid())
+	{
+		return;
+	}
 
-	//ViewFamily.ExposureSettings = ExposureSettings;
+	uint32 magic = ViewportThumbnailCacheFile::Magic;
+	uint32 version = ViewportThumbnailCacheFile::Version;
+	int32 numRecords = Records.Num();
+	*writer << magic << version << numRecords;
 
-	//ViewFamily.LandscapeLODOverride = LandscapeLODOverride;
+	// Images follow the index, in the same order
+	int64 offset = ViewportThumbnailCacheFile::HeaderSize + numRecords * ViewportThumbnailCacheFile::IndexRecordSize;
+	TArray<int64> newOffsets;
+	newOffsets.Reserve(numRecords);
 
-	FSceneView* View = CalcSceneView(&ViewFamily);
+	for (TPair<uint64, FRecord>& pair : Records)
+	{
+		FRecord& record = pair.Value;
+		*writer << pair.Key << offset << record.CompressedSize << record.Size.X << record.Size.Y << record.LastUsed;
 
-	ViewFamily.SetScreenPercentageInterface(new FLegacyScreenPercentageDriver(
-		ViewFamily, GlobalResolutionFraction, /* AllowPostProcessSettingsScreenPercentage = */ false));
+		newOffsets.Add(offset);
+		offset += record.CompressedSize;
+	}
 
-	FSlateRect SafeFrame;
-	View->CameraConstrainedViewRect = View->UnscaledViewRect;
-	//if ( CalculateEditorConstrainedViewRect(SafeFrame, Viewport) )
-	//{
-	//	View->CameraConstrainedViewRect = FIntRect(SafeFrame.Left, SafeFrame.Top, SafeFrame.Right, SafeFrame.Bottom);
-	//}
+	for (const TPair<uint64, FRecord>& pair : Records)
+	{
+		writer->Serialize(const_cast<uint8*>(GetCompressedData(pair.Value)), pair.Value.CompressedSize);
+	}
 
-	Canvas->Clear(GetBackgroundColor());
+	const bool bWritten = writer->Close() && !writer->IsError();
+	writer.Reset();
 
-	// workaround for hacky renderer code that uses GFrameNumber to decide whether to resize render targets
-	--GFrameNumber;
+	if (!bWritten)
+	{
+		IFileManager::Get().Delete(*tempFilename);
+		return;
+	}
 
-	// Draw the 3D scene
-	GetRendererModule().BeginRenderingViewFamily(Canvas, &ViewFamily);
+	// The mapping has to be released before the file it maps can be replaced
+	CloseMapping();
 
-	// Remove temporary debug lines.
-	// Possibly a hack. Lines may get added without the scene being rendered etc.
-	if (World->LineBatcher != NULL && (World->LineBatcher->BatchedLines.Num() || World->LineBatcher->BatchedPoints.Num()))
+	if (!IFileManager::Get().Move(*filename, *tempFilename))
+	{
+		// The records of the old mapping cannot be read anymore, start over next session
+		Records.Reset();
+		TotalCompressedSize = 0;
+		return;
+	}
+
+	bDirty = false;
+
+	// Later lookups read from the new file
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*filename));
+	if (MappedFile.IsValid())
 	{
-		World->LineBatcher->Flush();
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
 	}
 
-	if (World->ForegroundLineBatcher != NULL && (World->ForegroundLineBatcher->BatchedLines.Num() || World->ForegroundLineBatcher->BatchedPoints.Num()))
+	if (!MappedRegion.IsValid())
 	{
-		World->ForegroundLineBatcher->Flush();
+		// Images stored this session stay in memory, the ones only in the old mapping are lost until the next session reads the file
+		CloseMapping();
+		for (auto It = Records.CreateIterator(); It; ++It)
+		{
+			if (It.Value().MappedOffset != INDEX_NONE)
+			{
+				TotalCompressedSize -= It.Value().CompressedSize;
+				It.RemoveCurrent();
+			}
+		}
+		return;
 	}
 
-	Viewport = ViewportBackup;
+	int32 index = 0;
+	for (TPair<uint64, FRecord>& pair : Records)
+	{
+		pair.Value.MappedOffset = newOffsets[index++];
+		pair.Value.CompressedData.Empty();
+	}
 }
 
-/** True if the window is maximized or floating */
-bool FCustomViewportClient::IsVisible() const
-{
-	bool bIsVisible = false;
+//------------------------------------------------------
+// FViewportFrameReadback
+//------------------------------------------------------
 
-	if (VisibilityDelegate.IsBound())
+FViewportFrameReadback::FViewportFrameReadback(int32 NumStagingTextures)
+{
+	for (int32 i = 0; i < FMath::Max(NumStagingTextures, 1); i++)
 	{
-		// Call the visibility delegate to see if our parent viewport and layout configuration says we arevisible
-		bIsVisible = VisibilityDelegate.Execute();
+		Slots.Add(MakeShared<FSlot, ESPMode::ThreadSafe>());
 	}
+}
 
-	return bIsVisible;
+void FViewportFrameReadback::Request(const FOnViewportFrameRead& OnRead)
+{
+	QueuedReads.Add(OnRead);
 }
 
-void FCustomViewportClient::GetViewportDimensions(FIntPoint& OutOrigin, FIntPoint& Outize)
+bool FViewportFrameReadback::IsIdle() const
 {
-	OutOrigin = FIntPoint(0, 0);
-	if (Viewport != NULL)
+	return QueuedReads.Num() == 0 && !Slots.ContainsByPredicate([](const TSharedRef<FSlot, ESPMode::ThreadSafe>& slot) { return slot->bInFlight; });
+}
+
+void FViewportFrameReadback::Update(FRenderTarget& RenderTarget, const FIntRect& Rect)
+{
+	for (const TSharedRef<FSlot, ESPMode::ThreadSafe>& slot : Slots)
 	{
-		Outize.X = Viewport->GetSizeXY().X;
-		Outize.Y = Viewport->GetSizeXY().Y;
+		if (!slot->bInFlight)
+		{
+			continue;
+		}
+
+		if (slot->ReadSequence == slot->RequestSequence)
+		{
+			// The render thread leaves the pixels alone until the next copy of the slot, which only starts after this
+			const FOnViewportFrameRead onRead = slot->OnRead;
+			const TArray<FColor> pixels = MoveTemp(slot->Pixels);
+
+			slot->OnRead.Unbind();
+			slot->bInFlight = false;
+
+			onRead.ExecuteIfBound(slot->Size, pixels);
+		}
+		else if (!slot->bPollPending)
+		{
+			// Only the render thread can tell whether the copy landed, by the fence of the staging texture
+			slot->bPollPending = true;
+
+			TSharedRef<FSlot, ESPMode::ThreadSafe> polledSlot = slot;
+			ENQUEUE_RENDER_COMMAND(ViewportWidgetPollFrameReadback)([polledSlot](FRHICommandListImmediate& RHICmdList)
+			{
+				ReadPixels_RenderThread(RHICmdList, *polledSlot);
+				polledSlot->bPollPending = false;
+			});
+		}
 	}
-	else
+
+	for (const TSharedRef<FSlot, ESPMode::ThreadSafe>& slot : Slots)
 	{
-		Outize = FIntPoint(0, 0);
+		if (QueuedReads.Num() == 0)
+		{
+			break;
+		}
+
+		if (!slot->bInFlight)
+		{
+			slot->OnRead = QueuedReads[0];
+			QueuedReads.RemoveAt(0);
+
+			StartCopy(slot, RenderTarget, Rect);
+		}
 	}
 }
 
-void FCustomViewportClient::SetViewMode(EViewModeIndex InViewModeIndex)
+void FViewportFrameReadback::StartCopy(const TSharedRef<FSlot, ESPMode::ThreadSafe>& Slot, FRenderTarget& RenderTarget, const FIntRect& Rect)
 {
-	ViewModeParam = -1; // Reset value when the viewmode changes
-	ViewModeParamName = NAME_None;
-	ViewModeParamNameMap.Empty();
+	Slot->bInFlight = true;
+	const uint32 sequence = ++Slot->RequestSequence;
 
-	if (IsPerspective())
+	FTextureRHIRef texture(RenderTarget.GetRenderTargetTexture());
+	if (!texture.IsValid())
 	{
-		PerspViewModeIndex = InViewModeIndex;
-		ApplyViewMode(PerspViewModeIndex, true, EngineShowFlags);
-		bForcingUnlitForNewMap = false;
+		// Reported as a failed read, after the polls of the previous copy already queued
+		ENQUEUE_RENDER_COMMAND(ViewportWidgetFailFrameReadback)([Slot, sequence](FRHICommandListImmediate& RHICmdList)
+		{
+			Slot->CopySequence = sequence;
+			Slot->Size = FIntPoint::ZeroValue;
+			Slot->Pixels.Reset();
+			Slot->ReadSequence = sequence;
+		});
+		return;
 	}
-	else
+
+	ENQUEUE_RENDER_COMMAND(ViewportWidgetCopyFrame)([Slot, texture, Rect, sequence](FRHICommandListImmediate& RHICmdList)
 	{
-		OrthoViewModeIndex = InViewModeIndex;
-		ApplyViewMode(OrthoViewModeIndex, false, EngineShowFlags);
-	}
+		const FIntVector size = texture->GetSizeXYZ();
+		const EPixelFormat format = texture->GetFormat();
 
-	Invalidate();
+		// A resize, or a switch between the viewport and an atlas, needs a staging texture of the new size and format
+		if (!Slot->Readback.IsValid() || Slot->StagingSource != texture.GetReference() || Slot->StagingSize != size || Slot->Format != format)
+		{
+			Slot->Readback = MakeUnique<FRHIGPUTextureReadback>(TEXT("ViewportWidgetFrameReadback"));
+			Slot->StagingSource = texture.GetReference();
+			Slot->StagingSize = size;
+		}
+
+		Slot->CopySequence = sequence;
+		Slot->Pixels.Reset();
+
+		Slot->Size = Rect.IsEmpty() ? FIntPoint(size.X, size.Y) : Rect.Size();
+		Slot->Format = format;
+
+		// A rect copy lands at the same position in the staging texture
+		Slot->ReadOffset = Rect.IsEmpty() ? FIntPoint::ZeroValue : Rect.Min;
+
+		// The copy is queued on the GPU, the staging texture is mapped once its fence passed
+		RHICmdList.Transition(FRHITransitionInfo(texture, ERHIAccess::Unknown, ERHIAccess::CopySrc));
+		if (Rect.IsEmpty())
+		{
+			Slot->Readback->EnqueueCopy(RHICmdList, texture);
+		}
+		else
+		{
+			Slot->Readback->EnqueueCopy(RHICmdList, texture, FResolveRect(Rect.Min.X, Rect.Min.Y, Rect.Max.X, Rect.Max.Y));
+		}
+		RHICmdList.Transition(FRHITransitionInfo(texture, ERHIAccess::CopySrc, ERHIAccess::SRVMask));
+	});
 }
 
-void FCustomViewportClient::SetViewModes(const EViewModeIndex InPerspViewModeIndex, const EViewModeIndex InOrthoViewModeIndex)
+void FViewportFrameReadback::ReadPixels_RenderThread(FRHICommandListImmediate& RHICmdList, FSlot& Slot)
 {
-	PerspViewModeIndex = InPerspViewModeIndex;
-	OrthoViewModeIndex = InOrthoViewModeIndex;
-
-	if (IsPerspective())
+	// A copy whose pixels were read already, or one that has not started, leaves the staging texture to the next read
+	if (Slot.ReadSequence == Slot.CopySequence || !Slot.Readback.IsValid() || !Slot.Readback->IsReady())
 	{
-		ApplyViewMode(PerspViewModeIndex, true, EngineShowFlags);
+		return;
 	}
-	else
+
+	void* data = nullptr;
+	int32 rowPitchInPixels = 0;
+#if ENGINE_MAJOR_VERSION >= 5
+	data = Slot.Readback->Lock(rowPitchInPixels);
+#else
+	Slot.Readback->LockTexture(RHICmdList, data, rowPitchInPixels);
+#endif
+
+	const int32 width = Slot.Size.X;
+	const int32 height = Slot.Size.Y;
+
+	// Offset of the copied rect, in pixels from the start of the staging texture
+	const int32 offset = Slot.ReadOffset.Y * rowPitchInPixels + Slot.ReadOffset.X;
+
+	Slot.Pixels.Reset();
+	if (data && width > 0 && height > 0)
 	{
-		ApplyViewMode(OrthoViewModeIndex, false, EngineShowFlags);
+		Slot.Pixels.SetNumUninitialized(width * height);
+
+		switch (Slot.Format)
+		{
+		case PF_B8G8R8A8:
+			for (int32 y = 0; y < height; y++)
+			{
+				FMemory::Memcpy(&Slot.Pixels[y * width], (const FColor*)data + offset + y * rowPitchInPixels, width * sizeof(FColor));
+			}
+			break;
+
+		case PF_R8G8B8A8:
+			for (int32 y = 0; y < height; y++)
+			{
+				const uint8* row = (const uint8*)data + (offset + y * rowPitchInPixels) * 4;
+				for (int32 x = 0; x < width; x++)
+				{
+					Slot.Pixels[y * width + x] = FColor(row[x * 4], row[x * 4 + 1], row[x * 4 + 2], row[x * 4 + 3]);
+				}
+			}
+			break;
+
+		case PF_FloatRGBA:
+			for (int32 y = 0; y < height; y++)
+			{
+				const FFloat16Color* row = (const FFloat16Color*)data + offset + y * rowPitchInPixels;
+				for (int32 x = 0; x < width; x++)
+				{
+					Slot.Pixels[y * width + x] = FLinearColor(row[x]).ToFColor(true);
+				}
+			}
+			break;
+
+		default:
+			// Formats a viewport does not render to are reported as a failed read
+			Slot.Pixels.Reset();
+			break;
+		}
 	}
 
-	Invalidate();
+	Slot.Readback->Unlock();
+	Slot.ReadSequence = Slot.CopySequence;
 }
 
-void FCustomViewportClient::SetViewModeParam(int32 InViewModeParam)
+//------------------------------------------------------
+// FViewportViewBatcher
+//------------------------------------------------------
+
+FViewportViewBatcher::FViewportViewBatcher()
 {
-	ViewModeParam = InViewModeParam;
-	FName* BoundName = ViewModeParamNameMap.Find(ViewModeParam);
-	ViewModeParamName = BoundName ? *BoundName : FName();
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FViewportViewBatcher::RenderBatches);
+}
 
-	Invalidate();
+FViewportViewBatcher::~FViewportViewBatcher()
+{
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
 }
 
-bool FCustomViewportClient::IsViewModeParam(int32 InViewModeParam) const
+void FViewportViewBatcher::AddView(SViewportWidget* Viewport, const TSharedRef<FCustomPreviewScene>& Scene, FIntPoint Size)
 {
-	const FName* MappedName = ViewModeParamNameMap.Find(ViewModeParam);
-	// Check if the param and names match. The param name only gets updated on click, while the map is built at menu creation.
-	if (MappedName)
+	if (Size.X <= 0 || Size.Y <= 0)
 	{
-		return ViewModeParam == InViewModeParam && ViewModeParamName == *MappedName;
+		return;
 	}
-	else
+
+	FSceneBatch& batch = Batches.FindOrAdd(&Scene.Get());
+	batch.Scene = Scene;
+
+	FBatchedView* view = batch.Views.FindByPredicate([Viewport](const FBatchedView& batchedView) { return batchedView.Viewport == Viewport; });
+	if (!view)
 	{
-		return ViewModeParam == InViewModeParam && ViewModeParamName == NAME_None;
+		view = &batch.Views.AddDefaulted_GetRef();
+		view->Viewport = Viewport;
+		view->Rect = FIntRect();
 	}
+
+	view->Size = Size;
+	view->bQueued = true;
 }
 
-void FCustomViewportClient::Invalidate(bool bInvalidateChildViews, bool bInvalidateHitProxies)
+void FViewportViewBatcher::RemoveViewport(SViewportWidget* Viewport)
 {
-	if (Viewport)
+	for (TPair<const FCustomPreviewScene*, FSceneBatch>& pair : Batches)
 	{
-		if (bInvalidateHitProxies)
+		pair.Value.Views.RemoveAll([Viewport](const FBatchedView& view) { return view.Viewport == Viewport; });
+	}
+}
+
+bool FViewportViewBatcher::GetViewTarget(const SViewportWidget* Viewport, UTextureRenderTarget2D*& OutRenderTarget, FIntRect& OutRect) const
+{
+	for (const TPair<const FCustomPreviewScene*, FSceneBatch>& pair : Batches)
+	{
+		const FBatchedView* view = pair.Value.Views.FindByPredicate([Viewport](const FBatchedView& batchedView) { return batchedView.Viewport == Viewport; });
+		if (view && pair.Value.RenderTarget.IsValid() && view->Rect.Size() == view->Size)
 		{
-			// Invalidate hit proxies and display pixels.
-			Viewport->Invalidate();
+			OutRenderTarget = pair.Value.RenderTarget.Get();
+			OutRect = view->Rect;
+			return true;
 		}
-		else
+	}
+
+	return false;
+}
+
+void FViewportViewBatcher::RenderBatches()
+{
+	for (TMap<const FCustomPreviewScene*, FSceneBatch>::TIterator it = Batches.CreateIterator(); it; ++it)
+	{
+		FSceneBatch& batch = it.Value();
+
+		// Views of widgets no longer on screen are dropped, they are queued again once they show up
+		batch.Views.RemoveAll([](const FBatchedView& view) { return !view.bQueued && !view.Viewport->IsVisible(); });
+
+		if (!batch.Scene.IsValid() || batch.Views.Num() == 0)
 		{
-			// Invalidate only display pixels.
-			Viewport->InvalidateDisplay();
+			it.RemoveCurrent();
+			continue;
+		}
+
+		// Views not queued keep their last image, and a new or resized view is always queued, so a batch with none queued has nothing to render
+		if (batch.Views.ContainsByPredicate([](const FBatchedView& view) { return view.bQueued; }))
+		{
+			RenderBatch(batch);
 		}
 	}
 }
 
-void FCustomViewportClient::SetGameView(bool bGameViewEnable)
+void FViewportViewBatcher::Reset()
 {
-	// backup this state as we want to preserve it
-	bool bCompositeEditorPrimitives = EngineShowFlags.CompositeEditorPrimitives;
+	Batches.Reset();
+}
 
-	// defaults
-	FEngineShowFlags GameFlags(ESFIM_Game);
-	FEngineShowFlags EditorFlags(ESFIM_Editor);
+void FViewportViewBatcher::RenderBatch(FSceneBatch& Batch)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_RenderViewBatch);
+	CSV_SCOPED_TIMING_STAT(ViewportWidget, RenderViewBatch);
+
+	TSharedPtr<FCustomPreviewScene> scene = Batch.Scene.Pin();
+	UWorld* world = scene->GetWorld();
+
+	// Views keep their rect while their size holds, so the views not redrawn this frame keep their last image.
+	// A new or resized view moves them all, and they all render again
+	const bool bLayoutChanged = !Batch.RenderTarget.IsValid() || Batch.Views.ContainsByPredicate([](const FBatchedView& view) { return view.Rect.Size() != view.Size; });
+	if (bLayoutChanged)
 	{
-		// likely we can take the existing state
-		if (EngineShowFlags.Game)
+		const FIntPoint atlasSize = LayoutViews(Batch.Views);
+
+		if (!Batch.RenderTarget.IsValid())
 		{
-			GameFlags = EngineShowFlags;
-			EditorFlags = LastEngineShowFlags;
+			Batch.RenderTarget.Reset(NewObject<UTextureRenderTarget2D>(GetTransientPackage()));
 		}
-		else if (LastEngineShowFlags.Game)
+
+		UTextureRenderTarget2D* renderTarget = Batch.RenderTarget.Get();
+		if (renderTarget->SizeX < atlasSize.X || renderTarget->SizeY < atlasSize.Y || !renderTarget->GameThread_GetRenderTargetResource())
 		{
-			GameFlags = LastEngineShowFlags;
-			EditorFlags = EngineShowFlags;
+			renderTarget->InitCustomFormat(FMath::Max(renderTarget->SizeX, atlasSize.X), FMath::Max(renderTarget->SizeY, atlasSize.Y), PF_B8G8R8A8, false);
+			renderTarget->UpdateResourceImmediate(true);
+		}
+
+		for (FBatchedView& view : Batch.Views)
+		{
+			view.bQueued = true;
 		}
 	}
 
-	// toggle between the game and engine flags
-	if (bGameViewEnable)
+	FTextureRenderTargetResource* renderTargetResource = Batch.RenderTarget->GameThread_GetRenderTargetResource();
+
+	FCanvas canvas(renderTargetResource, nullptr, world, world->FeatureLevel);
+
+	const float timeSeconds = FApp::GetCurrentTime() - GStartTime;
+
+	FSceneViewFamilyContext viewFamily(FSceneViewFamily::ConstructionValues(
+		renderTargetResource,
+		scene->GetScene(),
+		FEngineShowFlags(ESFIM_Game))
+		.SetWorldTimes(timeSeconds, FApp::GetDeltaTime(), timeSeconds)
+		.SetRealtimeUpdate(true));
+
+	float resolutionFraction = 0.f;
+
+	for (FBatchedView& view : Batch.Views)
 	{
-		EngineShowFlags = GameFlags;
-		LastEngineShowFlags = EditorFlags;
+		if (!view.bQueued)
+		{
+			continue;
+		}
+
+		view.bQueued = false;
+
+		TSharedPtr<FCustomUMGViewportClient> client = view.Viewport->GetViewportClient();
+
+		// A family has one set of show flags, the views batched together take those of the first
+		if (viewFamily.Views.Num() == 0)
+		{
+			viewFamily.EngineShowFlags = client->GetViewFamilyShowFlags();
+		}
+
+		// Dynamic resolution is per family too, the sharpest view wins
+		resolutionFraction = FMath::Max(resolutionFraction, client->GetResolutionFraction());
+
+		client->CalcBatchedSceneView(&viewFamily, view.Rect);
 	}
-	else
+
+	if (viewFamily.Views.Num() > 0)
 	{
-		EngineShowFlags = EditorFlags;
-		LastEngineShowFlags = GameFlags;
+		viewFamily.SetScreenPercentageInterface(new FLegacyScreenPercentageDriver(
+			viewFamily, resolutionFraction, /* AllowPostProcessSettingsScreenPercentage = */ false));
+
+		GetRendererModule().BeginRenderingViewFamily(&canvas, &viewFamily);
 	}
 
-	// maintain this state
-	EngineShowFlags.SetCompositeEditorPrimitives(bCompositeEditorPrimitives);
-	LastEngineShowFlags.SetCompositeEditorPrimitives(bCompositeEditorPrimitives);
+	canvas.Flush_GameThread();
+}
 
-	//reset game engine show flags that may have been turned on by making a selection in game view
-	if (bGameViewEnable)
+FIntPoint FViewportViewBatcher::LayoutViews(TArray<FBatchedView>& Views)
+{
+	int32 maxViewWidth = 0;
+	int64 totalArea = 0;
+	for (const FBatchedView& view : Views)
 	{
-		EngineShowFlags.SetModeWidgets(false);
-		EngineShowFlags.SetSelection(false);
+		maxViewWidth = FMath::Max(maxViewWidth, view.Size.X);
+		totalArea += (int64)view.Size.X * view.Size.Y;
 	}
 
-	EngineShowFlags.SetSelectionOutline(false);
-
-	ApplyViewMode(GetViewMode(), IsPerspective(), EngineShowFlags);
-
-	bInGameViewMode = bGameViewEnable;
+	// Rows about as wide as the atlas is tall, in the order the views were added
+	const int32 rowWidth = FMath::Max(maxViewWidth, FMath::CeilToInt(FMath::Sqrt((double)totalArea)));
 
-	Invalidate();
-}
+	FIntPoint atlasSize = FIntPoint::ZeroValue;
+	FIntPoint cursor = FIntPoint::ZeroValue;
+	int32 rowHeight = 0;
 
-float FCustomViewportClient::UpdateViewportClientWindowDPIScale() const
-{
-	float DPIScale = 1.f;
-	if (ViewportWidget.IsValid())
+	for (FBatchedView& view : Views)
 	{
-		TSharedPtr<SWindow> WidgetWindow = FSlateApplication::Get().FindWidgetWindow(ViewportWidget.Pin().ToSharedRef());
-		if (WidgetWindow.IsValid())
+		if (cursor.X > 0 && cursor.X + view.Size.X > rowWidth)
 		{
-			DPIScale = WidgetWindow->GetNativeWindow()->GetDPIScaleFactor();
+			cursor = FIntPoint(0, cursor.Y + rowHeight);
+			rowHeight = 0;
 		}
+
+		view.Rect = FIntRect(cursor, cursor + view.Size);
+
+		cursor.X += view.Size.X;
+		rowHeight = FMath::Max(rowHeight, view.Size.Y);
+
+		atlasSize = atlasSize.ComponentMax(view.Rect.Max);
 	}
 
-	return DPIScale;
+	return atlasSize;
 }
 
 //------------------------------------------------------
@@ -1279,6 +4536,66 @@ void FViewportWidgetModule::StartupModule()
 
 void FViewportWidgetModule::ShutdownModule()
 {
+	ReleaseAllParkedViewports();
+	ThumbnailRenderer.ReleaseScene();
+	ViewBatcher.Reset();
+	ThumbnailCache.Flush();
+}
+
+TSharedRef<FCustomPreviewScene> FViewportWidgetModule::FindOrCreateSharedPreviewScene(FName Name, EViewportWidgetWorldProfile WorldProfile)
+{
+	if (TSharedPtr<FCustomPreviewScene> sharedPreviewScene = SharedPreviewScenes.FindRef(Name).Pin())
+	{
+		return sharedPreviewScene.ToSharedRef();
+	}
+
+	TSharedRef<FCustomPreviewScene> sharedPreviewScene = MakeShareable(new FCustomPreviewScene(WorldProfile));
+	SharedPreviewScenes.Add(Name, sharedPreviewScene);
+
+	return sharedPreviewScene;
+}
+
+static TAutoConsoleVariable<int32> CVarViewportWidgetMaxParkedViewports(
+	TEXT("r.ViewportWidget.MaxParkedViewports"),
+	4,
+	TEXT("Maximum number of released viewport widgets kept warm with their preview scene. The least recently parked ones are destroyed first."),
+	ECVF_Default);
+
+void FViewportWidgetModule::ParkViewport(FName Key, const TSharedRef<SViewportWidget>& Viewport)
+{
+	ReleaseParkedViewport(Key);
+
+	ParkedViewports.Emplace(Key, Viewport);
+
+	const int32 maxParkedViewports = FMath::Max(CVarViewportWidgetMaxParkedViewports.GetValueOnGameThread(), 0);
+	if (ParkedViewports.Num() > maxParkedViewports)
+	{
+		ParkedViewports.RemoveAt(0, ParkedViewports.Num() - maxParkedViewports);
+	}
+}
+
+TSharedPtr<SViewportWidget> FViewportWidgetModule::UnparkViewport(FName Key)
+{
+	const int32 index = ParkedViewports.IndexOfByPredicate([Key](const TPair<FName, TSharedPtr<SViewportWidget>>& parked) { return parked.Key == Key; });
+	if (index == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	TSharedPtr<SViewportWidget> viewport = ParkedViewports[index].Value;
+	ParkedViewports.RemoveAt(index);
+
+	return viewport;
+}
+
+void FViewportWidgetModule::ReleaseParkedViewport(FName Key)
+{
+	ParkedViewports.RemoveAll([Key](const TPair<FName, TSharedPtr<SViewportWidget>>& parked) { return parked.Key == Key; });
+}
+
+void FViewportWidgetModule::ReleaseAllParkedViewports()
+{
+	ParkedViewports.Empty();
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -10,6 +10,23 @@
 #include "ViewportWidget.generated.h"
 
 class FPreviewScene;
+class UTextureRenderTarget2D;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnViewportEntriesReady);
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnViewportFrameReadDynamic, FIntPoint, Size, const TArray<FColor>&, Pixels);
+
+/** Groups of UViewportWidget properties pushed to the Slate viewport together */
+enum class EViewportWidgetChanges : uint8
+{
+	None = 0,
+	View = 1 << 0,
+	Entries = 1 << 1,
+	Appearance = 1 << 2,
+	Lighting = 1 << 3,
+	MirroredActors = 1 << 4,
+};
+ENUM_CLASS_FLAGS(EViewportWidgetChanges);
+
 //------------------------------------------------------
 // UViewportWidget
 //------------------------------------------------------
@@ -37,6 +54,51 @@ class VIEWPORTWIDGET_API UViewportWidget : public UContentWidget
 	UPROPERTY(EditAnywhere, Category = Appearance, meta = (EditCondition = "EnablePreviewLighting"))
 	float SkyBrightness = 1.0f;
 
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (ToolTip = "Realtime renders every frame, On Demand renders only when the view, entries or lighting change, Snapshot renders a few frames after a change and then freezes the preview world"))
+	EViewportWidgetRedrawMode RedrawMode = EViewportWidgetRedrawMode::Realtime;
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (ClampMin = "1", ToolTip = "Frames rendered after each change in Snapshot mode before freezing, so temporal anti-aliasing can settle"))
+	int32 SnapshotFrameCount = 4;
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (ToolTip = "Stream entry classes in asynchronously instead of blocking the game thread. The previous entries stay on screen until the new ones are spawned"))
+	bool bAsyncLoadEntries = true;
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (ClampMin = "0", ToolTip = "Number of removed entry actors kept hidden per class and reused by the next entry of that class instead of spawning a new actor"))
+	int32 EntryActorPoolSize = 4;
+
+	UPROPERTY(EditAnywhere, Category = Performance)
+	FViewportWidgetTickPolicy TickPolicy;
+
+	UPROPERTY(EditAnywhere, Category = Performance)
+	FViewportWidgetResolutionSettings ResolutionSettings;
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (GetOptions = "GetQualityProfileNames", ToolTip = "Quality profile from the Viewport Widget project settings. None renders every feature"))
+	FName QualityProfile;
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (ToolTip = "Keep rendering while the window is minimized or the application is in the background"))
+	bool bDrawWhenAppIsHidden = false;
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (ToolTip = "Display Only skips the physics scene and audio of the preview world and spawns entries without collision. Applies when the widget is rebuilt"))
+	EViewportWidgetWorldProfile WorldProfile = EViewportWidgetWorldProfile::Full;
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (ToolTip = "Render from a preview world shared with the other viewports using the same name. Lighting is shared too"))
+	bool bUseSharedPreviewScene = false;
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (EditCondition = "bUseSharedPreviewScene"))
+	FName SharedPreviewSceneName = TEXT("Default");
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (EditCondition = "bUseSharedPreviewScene", ToolTip = "Render in one pass with the other viewports of the shared scene doing the same, shown a frame later. The views batched together take the show flags of the first one's quality profile"))
+	bool bBatchSharedSceneViews = false;
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (ToolTip = "Park the preview scene and its actors when the widget is released, and reattach them on the next rebuild instead of recreating them"))
+	bool bKeepSceneWarm = false;
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (EditCondition = "bKeepSceneWarm", ToolTip = "Widgets with the same key reuse the same parked scene. Defaults to the user widget class and widget name"))
+	FName WarmCacheKey;
+
+	UPROPERTY(EditAnywhere, Category = Performance, meta = (ToolTip = "Store the rendered image on disk once the viewport stops redrawing, and show it on later launches without loading the entries until the user hovers the viewport. Not used in Realtime mode"))
+	bool bUseThumbnailCache = false;
+
 	UFUNCTION(BlueprintCallable, Category="ViewportWidget")
 	FTransform GetViewTransform() const { return ViewTransform; }
 
@@ -52,6 +114,92 @@ class VIEWPORTWIDGET_API UViewportWidget : public UContentWidget
 	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
 	AActor* GetSpawnedActor(const int32 entryIndex) const;
 
+	/**
+	 * Shows these actors where they are, with the lighting and post processing of their world, instead of spawning the entries
+	 * into a preview world. Nothing is duplicated, the viewport only adds its own camera. An empty array goes back to the entries
+	 */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void SetMirroredActors(const TArray<AActor*>& Actors);
+
+	/** @return False while entry classes are still loading and GetSpawnedActor returns the previous entries' actors */
+	UFUNCTION(BlueprintPure, Category = "ViewportWidget")
+	bool AreEntriesReady() const;
+
+	/** Called once the actors of the entries set last have been spawned */
+	UPROPERTY(BlueprintAssignable, Category = "ViewportWidget")
+	FOnViewportEntriesReady OnEntriesReady;
+
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void SetFOV(float InFOV);
+
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void SetBackgroundColor(FColor InBackgroundColor);
+
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void SetLightBrightness(float InLightBrightness);
+
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void SetLightDirection(FRotator InLightDirection);
+
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void SetSkyBrightness(float InSkyBrightness);
+
+	/**
+	 * Holds back the changes of the setters until the matching CommitUpdate, which applies them all at once.
+	 * Use it when setting several properties in a row, e.g. every frame of an animation. Updates nest, the outermost commit applies
+	 */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void BeginUpdate();
+
+	/** Ends an update started by BeginUpdate, applying the changes made since if it is the outermost one */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void CommitUpdate();
+
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void SetRedrawMode(EViewportWidgetRedrawMode InRedrawMode);
+
+	/** Renders the scene on the next frame, for changes the widget cannot detect by itself */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void RequestRedraw();
+
+	/**
+	 * Creates the preview world and spawns the entries now instead of when the widget is first on screen,
+	 * e.g. while a menu opens so its previews are ready when it shows
+	 */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void Prewarm();
+
+	/**
+	 * Copies the last rendered frame to CPU memory without stalling the game, e.g. for screenshots or pixel checks.
+	 * The event is called a few frames later, with no pixels if the frame could not be read
+	 */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void ReadFrameAsync(FOnViewportFrameReadDynamic OnFrameRead);
+
+	/** Keeps rendering every frame for the given number of seconds, e.g. while a transition plays */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void SetRealtimeForDuration(float Seconds);
+
+	/** Destroys the scene parked under the key by a widget with bKeepSceneWarm */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	static void ReleaseWarmScene(FName Key);
+
+	/** Destroys every parked scene, e.g. on a level change */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	static void ReleaseAllWarmScenes();
+
+	/**
+	 * Renders every entry into one cell of a shared atlas in a single pass, for grids too large for a live viewport per item.
+	 *
+	 * @param CellSize		Size of a cell in pixels
+	 * @param OutUVRects	UV rect of each entry's cell in the atlas
+	 * @param RenderTarget	Atlas of a previous call to render into again, or null to create a new one
+	 * @param QualityProfile	Name of a quality profile of the project settings, None for the Thumbnail profile
+	 */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	static UTextureRenderTarget2D* RenderThumbnailAtlas(const TArray<FViewportWidgetEntry>& InEntries, const FViewportThumbnailCamera& Camera, int32 CellSize, TArray<FBox2D>& OutUVRects,
+		UTextureRenderTarget2D* RenderTarget = nullptr, FName QualityProfile = NAME_None);
+
 	//~ UWidget interface
 	virtual void SynchronizeProperties() override;
 	virtual void ReleaseSlateResources(bool bReleaseChildren) override;
@@ -66,6 +214,24 @@ protected:
 	virtual TSharedRef<SWidget> RebuildWidget() override;
 	//~ End of UWidget interface
 
+protected:
+	FName GetWarmCacheKey() const;
+
+	/** @return Hash of everything that affects the rendered image, 0 if the thumbnail cache is not used */
+	uint64 GetThumbnailCacheKey() const;
+
+	UFUNCTION()
+	TArray<FString> GetQualityProfileNames() const;
+
+	void HandleEntriesReady();
+
+	/** Pushes the changed properties to the viewport, or keeps them for CommitUpdate during an update */
+	void ApplyChanges(EViewportWidgetChanges Changes);
+
+	void SynchronizeLighting();
+
+	void SynchronizeMirroredActors();
+
 protected:
 	TSharedPtr<SViewportWidget> MyViewport;
 
@@ -74,4 +240,35 @@ protected:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidget")
 	TArray<FViewportWidgetEntry> Entries;
+
+	/** Nesting depth of BeginUpdate */
+	int32 UpdateDepth = 0;
+
+	/** Actors of the game world shown instead of the entries */
+	TArray<TWeakObjectPtr<AActor>> MirroredActors;
+
+	/** Prewarm was called before the Slate widget was built */
+	bool bPrewarmRequested = false;
+
+	/** Changes made during the current update */
+	EViewportWidgetChanges PendingChanges = EViewportWidgetChanges::None;
+};
+
+/** Batches the changes made to a viewport widget while in scope, see UViewportWidget::BeginUpdate */
+class FViewportWidgetUpdateScope
+{
+public:
+	explicit FViewportWidgetUpdateScope(UViewportWidget* InWidget)
+		: Widget(InWidget)
+	{
+		Widget->BeginUpdate();
+	}
+
+	~FViewportWidgetUpdateScope()
+	{
+		Widget->CommitUpdate();
+	}
+
+private:
+	UViewportWidget* Widget;
 };
\ No newline at end of file
@@ -0,0 +1,347 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#include "CustomPreviewScene.h"
+#include "ViewportWidgetStats.h"
+
+#include "Engine/World.h"
+#include "Engine/TextureCube.h"
+#include "GameFramework/Actor.h"
+#include "Components/ActorComponent.h"
+#include "Components/SkyLightComponent.h"
+#include "Components/DirectionalLightComponent.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Sky Light Capture"), STAT_ViewportWidget_SkyLightCapture, STATGROUP_ViewportWidget);
+
+static TAutoConsoleVariable<int32> CVarViewportWidgetMaxCapturesPerFrame(
+	TEXT("r.ViewportWidget.MaxCapturesPerFrame"),
+	1,
+	TEXT("Sky light and reflection captures preview scenes can make in a frame, the others wait for the next frames. 0 means no limit."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarViewportWidgetTextureStreaming(
+	TEXT("r.ViewportWidget.TextureStreaming"),
+	1,
+	TEXT("1 streams the textures of preview scenes at the mips their viewports need on screen, 0 keeps all their mips resident. Applies to preview scenes created afterwards."),
+	ECVF_Default);
+
+/** Frame of the last capture and how many were made in it, shared by all scenes */
+static uint64 GViewportWidgetCaptureFrame = 0;
+static int32 GViewportWidgetNumCapturesInFrame = 0;
+
+//------------------------------------------------------
+// FCustomPreviewScene
+//------------------------------------------------------
+
+FCustomPreviewScene::FCustomPreviewScene(ConstructionValues CVS)
+	: FPreviewScene(CVS)
+	, MaxPooledActorsPerClass(4)
+	, LastTickFrame(0)
+	, NumSpawnedActors(0)
+	, WorldProfile(EViewportWidgetWorldProfile::Full)
+	, CapturedEnvironmentHash(0)
+	, bHasCapture(false)
+	, bCapturePending(false)
+	, CaptureGeneration(0)
+{
+	INC_DWORD_STAT(STAT_ViewportWidget_NumPreviewWorlds);
+}
+
+FCustomPreviewScene::~FCustomPreviewScene()
+{
+	DEC_DWORD_STAT(STAT_ViewportWidget_NumPreviewWorlds);
+	DEC_DWORD_STAT_BY(STAT_ViewportWidget_NumEntryActors, NumSpawnedActors);
+}
+
+FCustomPreviewScene::FCustomPreviewScene(EViewportWidgetWorldProfile InWorldProfile)
+	: FCustomPreviewScene(GetConstructionValues(InWorldProfile), InWorldProfile)
+{
+}
+
+FCustomPreviewScene::FCustomPreviewScene(ConstructionValues CVS, EViewportWidgetWorldProfile InWorldProfile)
+	: FCustomPreviewScene(CVS)
+{
+	WorldProfile = InWorldProfile;
+}
+
+FPreviewScene::ConstructionValues FCustomPreviewScene::GetDefaultConstructionValues()
+{
+	return ConstructionValues().SetCreateDefaultLighting(true).SetEditor(false).SetForceMipsResident(!UsesTextureStreaming());
+}
+
+FPreviewScene::ConstructionValues FCustomPreviewScene::GetConstructionValues(EViewportWidgetWorldProfile InWorldProfile)
+{
+	ConstructionValues constructionValues = GetDefaultConstructionValues();
+
+	// Preview worlds never get navigation, AI or a game mode, what is left to skip is physics and audio
+	if (InWorldProfile == EViewportWidgetWorldProfile::DisplayOnly)
+	{
+		constructionValues.SetCreatePhysicsScene(false).ShouldSimulatePhysics(false).AllowAudioPlayback(false);
+	}
+
+	return constructionValues;
+}
+
+bool FCustomPreviewScene::UsesTextureStreaming()
+{
+	return CVarViewportWidgetTextureStreaming.GetValueOnGameThread() != 0;
+}
+
+bool FCustomPreviewScene::TryClaimFrameTick()
+{
+	if (LastTickFrame == GFrameCounter)
+	{
+		return false;
+	}
+
+	LastTickFrame = GFrameCounter;
+	return true;
+}
+
+AActor* FCustomPreviewScene::SpawnPooledActor(UClass* ActorClass, const FTransform& Transform, EPreviewActorOrigin& OutOrigin)
+{
+	if (TArray<FPooledActor>* pool = PooledActors.Find(ActorClass))
+	{
+		while (pool->Num() > 0)
+		{
+			const FPooledActor pooledActor = pool->Pop(false);
+			if (AActor* actor = pooledActor.Actor.Get())
+			{
+				actor->SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+				actor->SetActorEnableCollision(pooledActor.bCollisionEnabled);
+				actor->SetActorTickEnabled(pooledActor.bTickEnabled);
+				for (const TWeakObjectPtr<UActorComponent>& component : pooledActor.TickingComponents)
+				{
+					if (component.IsValid())
+					{
+						component->SetComponentTickEnabled(true);
+					}
+				}
+				actor->SetActorHiddenInGame(false);
+
+				OutOrigin = EPreviewActorOrigin::Reused;
+				return actor;
+			}
+		}
+	}
+
+	UWorld* world = GetWorld();
+	if (!world)
+	{
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnInfo.bNoFail = true;
+	SpawnInfo.ObjectFlags = RF_Transient | RF_Transactional;
+
+	OutOrigin = EPreviewActorOrigin::Spawned;
+	AActor* actor = world->SpawnActor(ActorClass, &Transform, SpawnInfo);
+	if (actor)
+	{
+		// Without a physics scene no physics state is created, collision is all that is left to turn off
+		if (WorldProfile == EViewportWidgetWorldProfile::DisplayOnly)
+		{
+			actor->SetActorEnableCollision(false);
+		}
+
+		NumSpawnedActors++;
+		INC_DWORD_STAT(STAT_ViewportWidget_NumEntryActors);
+	}
+
+	return actor;
+}
+
+void FCustomPreviewScene::ReleasePooledActor(AActor* Actor)
+{
+	TArray<FPooledActor>& pool = PooledActors.FindOrAdd(Actor->GetClass());
+	if (pool.Num() >= MaxPooledActorsPerClass)
+	{
+		if (UWorld* world = GetWorld())
+		{
+			world->DestroyActor(Actor);
+
+			NumSpawnedActors--;
+			DEC_DWORD_STAT(STAT_ViewportWidget_NumEntryActors);
+		}
+
+		return;
+	}
+
+	FPooledActor& pooledActor = pool.AddDefaulted_GetRef();
+	pooledActor.Actor = Actor;
+	pooledActor.bCollisionEnabled = Actor->GetActorEnableCollision();
+	pooledActor.bTickEnabled = Actor->IsActorTickEnabled();
+
+	for (UActorComponent* component : Actor->GetComponents())
+	{
+		if (component && component->IsComponentTickEnabled())
+		{
+			pooledActor.TickingComponents.Add(component);
+			component->SetComponentTickEnabled(false);
+		}
+	}
+
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+}
+
+void FCustomPreviewScene::SetMaxPooledActorsPerClass(int32 InMaxPooledActorsPerClass)
+{
+	MaxPooledActorsPerClass = FMath::Max(InMaxPooledActorsPerClass, 0);
+
+	UWorld* world = GetWorld();
+	for (TPair<TWeakObjectPtr<UClass>, TArray<FPooledActor>>& pool : PooledActors)
+	{
+		while (pool.Value.Num() > MaxPooledActorsPerClass)
+		{
+			AActor* actor = pool.Value.Pop(false).Actor.Get();
+			if (actor && world)
+			{
+				world->DestroyActor(actor);
+
+				NumSpawnedActors--;
+				DEC_DWORD_STAT(STAT_ViewportWidget_NumEntryActors);
+			}
+		}
+	}
+}
+
+AActor* FCustomPreviewScene::AcquireSharedActor(UClass* ActorClass, const FTransform& Transform, EPreviewActorOrigin& OutOrigin)
+{
+	for (FSharedActor& sharedActor : SharedActors)
+	{
+		if (sharedActor.ActorClass.Get() == ActorClass && sharedActor.Transform.Equals(Transform) && sharedActor.Actor.IsValid())
+		{
+			sharedActor.NumUsers++;
+
+			OutOrigin = EPreviewActorOrigin::Shared;
+			return sharedActor.Actor.Get();
+		}
+	}
+
+	AActor* actor = SpawnPooledActor(ActorClass, Transform, OutOrigin);
+	if (actor)
+	{
+		FSharedActor& sharedActor = SharedActors.AddDefaulted_GetRef();
+		sharedActor.Actor = actor;
+		sharedActor.ActorClass = ActorClass;
+		sharedActor.Transform = Transform;
+		sharedActor.NumUsers = 1;
+	}
+
+	return actor;
+}
+
+void FCustomPreviewScene::ReleaseSharedActor(AActor* Actor)
+{
+	const int32 index = SharedActors.IndexOfByPredicate([Actor](const FSharedActor& sharedActor) { return sharedActor.Actor.Get() == Actor; });
+	if (index == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (--SharedActors[index].NumUsers <= 0)
+	{
+		SharedActors.RemoveAtSwap(index);
+
+		ReleasePooledActor(Actor);
+	}
+}
+
+AActor* FCustomPreviewScene::MoveSharedActor(AActor* Actor, const FTransform& Transform, EPreviewActorOrigin& OutOrigin)
+{
+	FSharedActor* sharedActor = SharedActors.FindByPredicate([Actor](const FSharedActor& item) { return item.Actor.Get() == Actor; });
+	if (!sharedActor || sharedActor->NumUsers > 1)
+	{
+		UClass* actorClass = Actor->GetClass();
+		ReleaseSharedActor(Actor);
+		return AcquireSharedActor(actorClass, Transform, OutOrigin);
+	}
+
+	sharedActor->Transform = Transform;
+	Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+
+	OutOrigin = EPreviewActorOrigin::Shared;
+	return Actor;
+}
+
+float FCustomPreviewScene::GetSkyBrightness() const
+{
+	return SkyLight ? SkyLight->Intensity : 0.f;
+}
+
+float FCustomPreviewScene::GetLightBrightness() const
+{
+	return DirectionalLight ? DirectionalLight->Intensity : 0.f;
+}
+
+void FCustomPreviewScene::RequestCapture(UTextureCube* Cubemap)
+{
+	if (SkyCubemap.Get() != Cubemap)
+	{
+		SkyCubemap = Cubemap;
+		SetSkyCubemap(Cubemap);
+	}
+
+	RequestCapture();
+}
+
+void FCustomPreviewScene::RequestCapture()
+{
+	if (!bHasCapture || GetEnvironmentHash() != CapturedEnvironmentHash)
+	{
+		bCapturePending = true;
+	}
+}
+
+void FCustomPreviewScene::InvalidateCapture()
+{
+	bCapturePending = true;
+}
+
+void FCustomPreviewScene::UpdatePendingCapture(bool bIgnoreBudget)
+{
+	if (!bCapturePending || !GetWorld())
+	{
+		return;
+	}
+
+	if (GViewportWidgetCaptureFrame != GFrameCounter)
+	{
+		GViewportWidgetCaptureFrame = GFrameCounter;
+		GViewportWidgetNumCapturesInFrame = 0;
+	}
+
+	const int32 maxCapturesPerFrame = CVarViewportWidgetMaxCapturesPerFrame.GetValueOnGameThread();
+	if (!bIgnoreBudget && maxCapturesPerFrame > 0 && GViewportWidgetNumCapturesInFrame >= maxCapturesPerFrame)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ViewportWidget_SkyLightCapture);
+	CSV_SCOPED_TIMING_STAT(ViewportWidget, SkyLightCapture);
+
+	GViewportWidgetNumCapturesInFrame++;
+
+	// The sky light only queues itself for a capture when registered or marked dirty
+	if (SkyLight)
+	{
+		SkyLight->SetCaptureIsDirty();
+	}
+
+	UpdateCaptureContents();
+
+	CapturedEnvironmentHash = GetEnvironmentHash();
+	bHasCapture = true;
+	bCapturePending = false;
+	CaptureGeneration++;
+}
+
+uint32 FCustomPreviewScene::GetEnvironmentHash() const
+{
+	const UTextureCube* cubemap = SkyCubemap.Get();
+	return HashCombine(GetTypeHash(cubemap), GetTypeHash(cubemap ? cubemap->GetLightingGuid() : FGuid()));
+}
@@ -3,6 +3,20 @@
 #pragma once
 
 #include "PreviewScene.h"
+#include "ViewportWidgetEntry.h"
+
+class UTextureCube;
+
+/** Where an actor handed out by FCustomPreviewScene comes from, which tells the caller what still has to be done to it */
+enum class EPreviewActorOrigin : uint8
+{
+	/** Newly spawned, needs the full setup */
+	Spawned,
+	/** Taken back from the pool of released actors, needs to be reset */
+	Reused,
+	/** Already shown by another viewport, ready to use */
+	Shared,
+};
 
 //------------------------------------------------------
 // FCustomPreviewScene
@@ -10,5 +24,123 @@
 
 class VIEWPORTWIDGET_API FCustomPreviewScene : public FPreviewScene
 {
+public:
+	FCustomPreviewScene(ConstructionValues CVS = GetDefaultConstructionValues());
+	explicit FCustomPreviewScene(EViewportWidgetWorldProfile InWorldProfile);
+
+	/** Creates a scene with a profile from construction values the caller adjusted, e.g. from GetConstructionValues */
+	FCustomPreviewScene(ConstructionValues CVS, EViewportWidgetWorldProfile InWorldProfile);
+	virtual ~FCustomPreviewScene();
+
+	/** @return The construction values used for the preview scenes of viewport widgets */
+	static ConstructionValues GetDefaultConstructionValues();
+
+	/** @return The construction values of a preview scene with the given profile */
+	static ConstructionValues GetConstructionValues(EViewportWidgetWorldProfile InWorldProfile);
+
+	EViewportWidgetWorldProfile GetWorldProfile() const { return WorldProfile; }
+
+	/**
+	 * @return True if the textures of preview scenes are streamed according to the views registered by their viewports,
+	 * false if all their mips are kept resident. See r.ViewportWidget.TextureStreaming
+	 */
+	static bool UsesTextureStreaming();
+
+	/**
+	 * A world shared by several viewports must only be ticked once per frame.
+	 * @return True the first time it is called in a frame
+	 */
+	bool TryClaimFrameTick();
+
+	/** Spawns an actor of the given class at the transform, reusing a released one of the same class if the pool has any */
+	AActor* SpawnPooledActor(UClass* ActorClass, const FTransform& Transform, EPreviewActorOrigin& OutOrigin);
+
+	/** Hides and parks the actor so the next spawn of its class can reuse it, or destroys it if the pool of its class is full */
+	void ReleasePooledActor(AActor* Actor);
+
+	/** Sets how many released actors are kept per class, extra ones are destroyed */
+	void SetMaxPooledActorsPerClass(int32 InMaxPooledActorsPerClass);
+
+	/** Spawns an actor of the given class at the transform, or reuses the one already spawned there for another viewport */
+	AActor* AcquireSharedActor(UClass* ActorClass, const FTransform& Transform, EPreviewActorOrigin& OutOrigin);
+
+	/** Releases an actor obtained from AcquireSharedActor, returning it to the pool once no viewport uses it anymore */
+	void ReleaseSharedActor(AActor* Actor);
+
+	/**
+	 * Moves an actor obtained from AcquireSharedActor. An actor other viewports still use stays where it is,
+	 * and the caller gets another one acquired at the new transform instead.
+	 */
+	AActor* MoveSharedActor(AActor* Actor, const FTransform& Transform, EPreviewActorOrigin& OutOrigin);
+
+	/** @return Intensity of the sky light, 0 if the scene has none */
+	float GetSkyBrightness() const;
+
+	/** @return Intensity of the directional light, 0 if the scene has none */
+	float GetLightBrightness() const;
+
+	/** Sets the sky cubemap and asks for the captures to be updated, unless the scene was last captured with the same one */
+	void RequestCapture(UTextureCube* Cubemap);
+
+	/** Asks for the captures to be updated if the scene was never captured or its cubemap changed since */
+	void RequestCapture();
+
+	/** Asks for the captures to be updated even though the environment did not change, e.g. after reflection captures were spawned */
+	void InvalidateCapture();
+
+	/**
+	 * Updates the sky light and reflection captures if asked for. Captures are expensive, so no more than
+	 * r.ViewportWidget.MaxCapturesPerFrame are made in a frame across all scenes, the others wait for the next frames.
+	 *
+	 * @param bIgnoreBudget	Captures now whatever the frame budget, for one-shot renders that have no later frame to wait for
+	 */
+	void UpdatePendingCapture(bool bIgnoreBudget = false);
+
+	/** @return Incremented by every capture, tells the viewports of the scene when to redraw */
+	uint32 GetCaptureGeneration() const { return CaptureGeneration; }
+
+private:
+	struct FSharedActor
+	{
+		TWeakObjectPtr<AActor> Actor;
+		TWeakObjectPtr<UClass> ActorClass;
+		FTransform Transform;
+		int32 NumUsers;
+	};
+
+	/** A released actor with the state it had before being parked */
+	struct FPooledActor
+	{
+		TWeakObjectPtr<AActor> Actor;
+		bool bCollisionEnabled;
+		bool bTickEnabled;
+		TArray<TWeakObjectPtr<UActorComponent>> TickingComponents;
+	};
+
+	TArray<FSharedActor> SharedActors;
+
+	TMap<TWeakObjectPtr<UClass>, TArray<FPooledActor>> PooledActors;
+
+	int32 MaxPooledActorsPerClass;
+
+	uint64 LastTickFrame;
+
+	/** Actors spawned through the pool and still alive, for the entry actor stat */
+	int32 NumSpawnedActors;
+
+	EViewportWidgetWorldProfile WorldProfile;
+
+	/** @return Hash of everything the captures depend on */
+	uint32 GetEnvironmentHash() const;
+
+	TWeakObjectPtr<UTextureCube> SkyCubemap;
+
+	/** Environment hash of the last capture */
+	uint32 CapturedEnvironmentHash;
+
+	bool bHasCapture;
+
+	bool bCapturePending;
 
-};
\ No newline at end of file
+	uint32 CaptureGeneration;
+};
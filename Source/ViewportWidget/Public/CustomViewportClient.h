@@ -11,14 +11,17 @@
 #include "UObject/GCObject.h"
 #include "ShowFlags.h"
 #include "Components/Viewport.h"
+#include "ViewportWidgetEntry.h"
 
 class SWindow;
 class FSceneInterface;
 class FSceneView;
 class FSceneViewFamily;
+class FSceneViewStateInterface;
 class FCustomPreviewScene;
 class SViewportWidget;
 class FUMGViewportClient;
+class FViewportGPUTimer;
 
 enum class ECustomViewportType :uint8;
 
@@ -85,9 +88,106 @@ public:
 	FCustomUMGViewportClient(FPreviewScene* InPreviewScene = nullptr);
 	virtual ~FCustomUMGViewportClient();
 
+	using FViewElementDrawer::Draw;
+
+	/** Same as the UMG client's Draw, rendering at ResolutionFraction and timing the GPU work when asked to */
+	virtual void Draw(FViewport* InViewport, FCanvas* Canvas) override;
+
 	void SetViewFOV(const float InFOV) { 
 		ViewInfo.FOV = InFOV;
 	};
+
+	float GetViewFOV() const { return ViewInfo.FOV; }
+
+	/** Sets the scene to render, for a client created before its scene. Nothing is drawn without one */
+	void SetPreviewScene(FPreviewScene* InPreviewScene) { PreviewScene = InPreviewScene; }
+
+	/** Renders this world, usually the game world, instead of the preview scene. nullptr to render the preview scene again */
+	void SetMirroredWorld(UWorld* InMirroredWorld) { MirroredWorld = InMirroredWorld; }
+	bool IsMirroringWorld() const { return MirroredWorld.IsValid(); }
+
+	virtual UWorld* GetWorld() const override;
+
+	/** @return The scene of the mirrored world if any, of the preview scene otherwise */
+	FSceneInterface* GetScene() const;
+
+	/**
+	 * Normally the viewport stops rendering when its window is minimized or the application is in the background.
+	 * This lets a viewport keep rendering regardless, e.g. when it is captured for streaming.
+	 */
+	virtual bool WantsDrawWhenAppIsHidden() const { return bDrawWhenAppIsHidden; }
+
+	void SetDrawWhenAppIsHidden(bool bInDrawWhenAppIsHidden) { bDrawWhenAppIsHidden = bInDrawWhenAppIsHidden; }
+
+	/** Restricts rendering to the given primitives, so viewports sharing a preview scene only show their own entries */
+	void SetShowOnlyPrimitives(const TOptional<TSet<FPrimitiveComponentId>>& InShowOnlyPrimitives) { ShowOnlyPrimitives = InShowOnlyPrimitives; }
+
+	virtual FSceneView* CalcSceneView(FSceneViewFamily* ViewFamily) override;
+
+	/** Same as CalcSceneView, for a view covering only part of the family's render target and without view state */
+	FSceneView* CalcSceneView(FSceneViewFamily* ViewFamily, const FIntRect& ViewRect);
+
+	/** Same as CalcSceneView, for the client's view batched with others in a family. Keeps the view state, so temporal effects and occlusion carry over */
+	FSceneView* CalcBatchedSceneView(FSceneViewFamily* ViewFamily, const FIntRect& ViewRect);
+
+	/** Same as Draw, into the whole render target of a canvas rather than a viewport, for rendering with no widget on screen */
+	void DrawOffscreen(FCanvas* Canvas);
+
+	/** @return The show flags Draw renders its view family with, for families batching the views of several clients */
+	FEngineShowFlags GetViewFamilyShowFlags() const;
+
+	/** Ticks the preview world with the level tick type set by SetLevelTick */
+	virtual void Tick(float InDeltaTime) override;
+
+	void SetLevelTick(ELevelTick InLevelTick) { LevelTick = InLevelTick; }
+
+	/** Sets the fraction of the viewport's pixel size the scene is rendered at before upscaling */
+	void SetResolutionFraction(float InResolutionFraction) { ResolutionFraction = InResolutionFraction; }
+	float GetResolutionFraction() const { return ResolutionFraction; }
+
+	/** Restricts the rendering features to those of the profile, nullptr to render with the default show flags */
+	void SetQualityProfile(const FViewportWidgetQualityProfile* InQualityProfile);
+
+	/** Sets the DPI scale of the window the viewport is in, as known by its widget */
+	void SetWindowDPIScale(float InDPIScale);
+
+	/** Starts or stops measuring the GPU time of each render, if the RHI supports timestamp queries */
+	void SetMeasureGPUTime(bool bMeasure);
+
+	/**
+	 * @param OutGPUTimeMs	GPU time of the latest measured render, a few frames old
+	 * @return True if a measurement arrived since the last call
+	 */
+	bool ConsumeGPUTime(float& OutGPUTimeMs);
+
+protected:
+	/** FCommonViewportClient interface, the DPI scale set by the widget rather than a window search */
+	virtual float UpdateViewportClientWindowDPIScale() const override { return WindowDPIScale; }
+
+	/** Applies the quality profile, if any, to a view family's show flags */
+	void ApplyQualityProfile(FEngineShowFlags& ShowFlags) const;
+
+	/** Applies the per view settings of the quality profile, if any */
+	void ApplyQualityProfile(FSceneView* View) const;
+
+	/** Sets up a view covering a rect of the family's render target, with the given view state or none */
+	FSceneView* CalcSceneViewInRect(FSceneViewFamily* ViewFamily, const FIntRect& ViewRect, FSceneViewStateInterface* InViewState);
+
+	bool bDrawWhenAppIsHidden;
+
+	float ResolutionFraction;
+
+	float WindowDPIScale;
+
+	TSharedPtr<FViewportGPUTimer, ESPMode::ThreadSafe> GPUTimer;
+
+	ELevelTick LevelTick;
+
+	TOptional<TSet<FPrimitiveComponentId>> ShowOnlyPrimitives;
+
+	TOptional<FViewportWidgetQualityProfile> QualityProfile;
+
+	TWeakObjectPtr<UWorld> MirroredWorld;
 };
 
 class VIEWPORTWIDGET_API FCustomViewportClient : public FCommonViewportClient, public FViewElementDrawer
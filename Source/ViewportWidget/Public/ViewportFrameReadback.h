@@ -0,0 +1,90 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PixelFormat.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Templates/Atomic.h"
+
+class FRenderTarget;
+class FRHIGPUTextureReadback;
+class FRHITexture;
+class FRHICommandListImmediate;
+
+/** Called on the game thread with the frame read back, or with no pixels if it could not be read */
+DECLARE_DELEGATE_TwoParams(FOnViewportFrameRead, FIntPoint /*Size*/, const TArray<FColor>& /*Pixels*/);
+
+//------------------------------------------------------
+// FViewportFrameReadback
+//------------------------------------------------------
+
+/**
+ * Copies the frames of a scene viewport, or of a batched view's rect of an atlas, to CPU memory through a ring of staging textures, without flushing the render thread
+ * or waiting for the GPU. A read completes a few frames after it is requested. Requests beyond the size of the ring wait for a free staging texture.
+ */
+class VIEWPORTWIDGET_API FViewportFrameReadback
+{
+public:
+	explicit FViewportFrameReadback(int32 NumStagingTextures = 3);
+
+	/** Queues a read of the viewport's last rendered frame. Reads still pending when the viewport is destroyed are dropped */
+	void Request(const FOnViewportFrameRead& OnRead);
+
+	/**
+	 * Starts the copies of queued reads into free staging textures and completes the reads whose copy landed. To call every game thread tick
+	 *
+	 * @param RenderTarget	The viewport, or the atlas of a batched view
+	 * @param Rect			Rect of the frame in the render target, empty for all of it
+	 */
+	void Update(FRenderTarget& RenderTarget, const FIntRect& Rect = FIntRect());
+
+	/** @return True if no read is queued or in flight */
+	bool IsIdle() const;
+
+private:
+	/** A staging texture, shared with the render thread commands that use it */
+	struct FSlot
+	{
+		TUniquePtr<FRHIGPUTextureReadback> Readback;
+
+		FOnViewportFrameRead OnRead;
+
+		/** Size and format of the copied frame, set on the render thread */
+		FIntPoint Size;
+		EPixelFormat Format = PF_Unknown;
+
+		/** Position of the copied rect in the staging texture, where the read starts */
+		FIntPoint ReadOffset = FIntPoint::ZeroValue;
+
+		/** Texture and size the staging texture was created for, it is sized and formatted from the first texture it copies */
+		const FRHITexture* StagingSource = nullptr;
+		FIntVector StagingSize = FIntVector::ZeroValue;
+
+		/** Filled on the render thread once the copy landed */
+		TArray<FColor> Pixels;
+
+		bool bInFlight = false;
+
+		/** Number of the slot's latest copy, counted on the game thread */
+		uint32 RequestSequence = 0;
+
+		/** Number of the copy the render thread last started */
+		uint32 CopySequence = 0;
+
+		/** Number of the copy whose pixels were read. The read is complete once it matches RequestSequence */
+		TAtomic<uint32> ReadSequence { 0 };
+
+		/** True while a poll is queued on the render thread, so polls of an old copy cannot pile up behind a new one */
+		FThreadSafeBool bPollPending;
+	};
+
+	void StartCopy(const TSharedRef<FSlot, ESPMode::ThreadSafe>& Slot, FRenderTarget& RenderTarget, const FIntRect& Rect);
+
+	/** Maps the staging texture of a slot whose copy landed and converts its pixels */
+	static void ReadPixels_RenderThread(FRHICommandListImmediate& RHICmdList, FSlot& Slot);
+
+	TArray<TSharedRef<FSlot, ESPMode::ThreadSafe>> Slots;
+
+	TArray<FOnViewportFrameRead> QueuedReads;
+};
@@ -0,0 +1,88 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "ViewportWidgetEntry.h"
+#include "ViewportOffscreenRenderer.generated.h"
+
+class FCustomPreviewScene;
+class FCustomUMGViewportClient;
+class UTextureRenderTarget2D;
+class AActor;
+
+//------------------------------------------------------
+// UViewportOffscreenRenderer
+//------------------------------------------------------
+
+/**
+ * Renders entries into a render target through the same preview world and view setup as a viewport widget, with no Slate widget or scene viewport.
+ * Meant for tools and commandlets generating previews in bulk. The world and the spawned entries are kept between renders, so one renderer
+ * can render the same entries from many cameras.
+ */
+UCLASS(BlueprintType)
+class VIEWPORTWIDGET_API UViewportOffscreenRenderer : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Systems created in the preview world, read when the world is created on the first render */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidget")
+	EViewportWidgetWorldProfile WorldProfile = EViewportWidgetWorldProfile::DisplayOnly;
+
+	/** Name of a quality profile of the project settings, None to render with the default show flags */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidget")
+	FName QualityProfile;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidget")
+	float LightBrightness = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidget")
+	FRotator LightDirection = FRotator(-40.f, -67.5f, 0.f);
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidget")
+	float SkyBrightness = 1.f;
+
+	/** Creates a renderer owned by the transient package, for C++ callers with no outer at hand */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	static UViewportOffscreenRenderer* CreateOffscreenRenderer();
+
+	/** Spawns the entries to render, reusing the actors of the previous entries of the same class */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void SetEntries(const TArray<FViewportWidgetEntry>& InEntries);
+
+	/**
+	 * Renders the entries, seen from the camera, into the whole render target. The render is queued on the render thread like any other,
+	 * reading the render target back waits for it.
+	 *
+	 * @param Size				Size of the image in pixels
+	 * @param RenderTarget		Render target to render into, resized as needed. A new one is created if null
+	 * @param WorldDeltaSeconds	Time the preview world is ticked by before rendering, e.g. to let animations pose
+	 * @return The render target, or nullptr if the size is empty
+	 */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	UTextureRenderTarget2D* Render(const FViewportThumbnailCamera& Camera, FIntPoint Size, UTextureRenderTarget2D* RenderTarget = nullptr, float WorldDeltaSeconds = 0.f);
+
+	/** Destroys the preview world and its actors. The next render creates them again */
+	UFUNCTION(BlueprintCallable, Category = "ViewportWidget")
+	void ReleaseScene();
+
+	//~ UObject interface
+	virtual void BeginDestroy() override;
+
+private:
+	/** Creates the preview world and spawns the entries set before it existed */
+	void EnsurePreviewScene();
+
+	void SpawnEntryActors();
+	void ReleaseEntryActors();
+
+	TArray<FViewportWidgetEntry> Entries;
+
+	TArray<TWeakObjectPtr<AActor>> EntryActors;
+
+	TSharedPtr<FCustomPreviewScene> PreviewScene;
+
+	TSharedPtr<FCustomUMGViewportClient> Client;
+};
@@ -0,0 +1,77 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class SViewportWidget;
+
+//------------------------------------------------------
+// FViewportRenderScheduler
+//------------------------------------------------------
+
+/**
+ * Decides which viewport widgets render each frame so that screens with many previews share one frame budget.
+ * Focused and hovered viewports always render, the others are served round-robin, oldest render first,
+ * within the budget set by the r.ViewportWidget.* console variables.
+ */
+class VIEWPORTWIDGET_API FViewportRenderScheduler
+{
+public:
+	FViewportRenderScheduler();
+
+	void Register(SViewportWidget* Viewport);
+	void Unregister(SViewportWidget* Viewport);
+
+	/**
+	 * Asks for permission to render the viewport this frame. A denied viewport is remembered and gets priority on a later frame.
+	 *
+	 * @param bHighPriority	True for focused or hovered viewports, which render at full rate
+	 * @return True if the viewport may render now
+	 */
+	bool RequestRender(SViewportWidget* Viewport, bool bHighPriority);
+
+	/** @return The number of live viewport widgets */
+	int32 GetNumViewports() const { return Viewports.Num(); }
+
+	/** @return The number of viewports rendered during the previous frame */
+	int32 GetNumRenderedLastFrame() const { return NumRenderedLastFrame; }
+
+private:
+	struct FScheduledViewport
+	{
+		SViewportWidget* Viewport;
+
+		/** Frame of the last render, used for the round-robin order */
+		uint64 LastRenderFrame;
+
+		/** True if the viewport asked to render this frame */
+		bool bWantsRender;
+
+		/** True if the viewport was denied last frame and holds a reserved slot this frame */
+		bool bReserved;
+
+		bool bHighPriority;
+	};
+
+	/** Distributes this frame's slots among the viewports denied last frame */
+	void BeginFrame();
+
+	/** @return How many viewports may render this frame, MAX_int32 if unlimited */
+	int32 ComputeFrameBudget();
+
+	TArray<FScheduledViewport> Viewports;
+
+	uint64 CurrentFrame;
+
+	int32 FrameBudget;
+
+	/** Slots held for reserved viewports that have not asked to render yet this frame */
+	int32 NumReservedSlots;
+
+	int32 NumRenderedThisFrame;
+	int32 NumRenderedLastFrame;
+
+	/** View budget derived from the GPU frame time when r.ViewportWidget.GPUBudgetMs is set, negative until the first frame */
+	float GPUViewBudget;
+};
@@ -0,0 +1,81 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+//------------------------------------------------------
+// FViewportThumbnailCache
+//------------------------------------------------------
+
+/**
+ * Rendered viewport images kept across sessions, keyed by a hash of everything that affects the image.
+ * Images are stored compressed in a single file, memory mapped on first use and rewritten on Flush.
+ * The least recently used images are evicted once the cache outgrows r.ViewportWidget.ThumbnailCacheSizeMB.
+ */
+class VIEWPORTWIDGET_API FViewportThumbnailCache
+{
+public:
+	FViewportThumbnailCache();
+	~FViewportThumbnailCache();
+
+	/**
+	 * @param OutSize		Size of the image in pixels
+	 * @param OutPixels		The image, row by row
+	 * @return True if an image is cached for the key
+	 */
+	bool Find(uint64 Key, FIntPoint& OutSize, TArray<FColor>& OutPixels);
+
+	/** @return True if an image is cached for the key, without decompressing it */
+	bool Contains(uint64 Key);
+
+	void Store(uint64 Key, const FIntPoint& Size, const TArray<FColor>& Pixels);
+
+	/** Writes the cache file if anything changed since it was opened */
+	void Flush();
+
+private:
+	struct FRecord
+	{
+		FIntPoint Size;
+
+		/** UTC ticks of the last use, persisted so eviction order survives sessions */
+		int64 LastUsed;
+
+		/** Offset of the compressed image in the mapped file, INDEX_NONE if the image was stored this session */
+		int64 MappedOffset;
+
+		int32 CompressedSize;
+
+		/** Compressed image of a record stored this session */
+		TArray<uint8> CompressedData;
+	};
+
+	/** Maps the cache file and reads its index, once */
+	void Open();
+
+	void CloseMapping();
+
+	/** Drops the least recently used records until the cache fits its budget */
+	void EvictToBudget();
+
+	/** @return The compressed image of a record, from the mapping or from memory */
+	const uint8* GetCompressedData(const FRecord& Record) const;
+
+	static FString GetCacheFilename();
+
+	TMap<uint64, FRecord> Records;
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	int64 TotalCompressedSize;
+
+	bool bOpened;
+
+	/** True if records were added or evicted since the file was written */
+	bool bDirty;
+};
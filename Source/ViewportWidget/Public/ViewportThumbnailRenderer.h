@@ -0,0 +1,46 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FCustomPreviewScene;
+class FCustomUMGViewportClient;
+class UTextureRenderTarget2D;
+struct FViewportWidgetEntry;
+struct FViewportThumbnailCamera;
+
+//------------------------------------------------------
+// FViewportThumbnailRenderer
+//------------------------------------------------------
+
+/**
+ * Renders many entries into the cells of one texture atlas, in a single view family over a preview world it keeps between calls.
+ * Meant for grids of static previews that would be too expensive as one live viewport widget each.
+ */
+class VIEWPORTWIDGET_API FViewportThumbnailRenderer
+{
+public:
+	FViewportThumbnailRenderer();
+	~FViewportThumbnailRenderer();
+
+	/**
+	 * Renders each entry, seen from the camera, into its own square cell of the atlas. Cells are laid out row by row.
+	 *
+	 * @param CellSize		Size of a cell in pixels
+	 * @param OutUVRects	UV rect of each entry's cell, in the order of the entries
+	 * @param RenderTarget	Atlas to render into, resized as needed. A new one is created if null
+	 * @param QualityProfile	Name of a quality profile of the project settings, None for the Thumbnail profile
+	 * @return The atlas, or nullptr if there was nothing to render
+	 */
+	UTextureRenderTarget2D* RenderAtlas(const TArray<FViewportWidgetEntry>& Entries, const FViewportThumbnailCamera& Camera, int32 CellSize, TArray<FBox2D>& OutUVRects,
+		UTextureRenderTarget2D* RenderTarget = nullptr, FName QualityProfile = NAME_None);
+
+	/** Destroys the preview world, e.g. once the grid using it is closed */
+	void ReleaseScene();
+
+private:
+	TSharedPtr<FCustomPreviewScene> PreviewScene;
+
+	TSharedPtr<FCustomUMGViewportClient> Client;
+};
@@ -0,0 +1,77 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/StrongObjectPtr.h"
+
+class FCustomPreviewScene;
+class SViewportWidget;
+class UTextureRenderTarget2D;
+
+//------------------------------------------------------
+// FViewportViewBatcher
+//------------------------------------------------------
+
+/**
+ * Renders the views of viewport widgets sharing a preview scene as a single view family, so the scene, shadow and GPU scene setup
+ * is done once per scene and frame instead of once per widget. Each view renders into its own rect of an atlas owned by the scene's batch,
+ * which the widgets draw from. Views queued during a frame are rendered at its end and shown on the next one.
+ */
+class VIEWPORTWIDGET_API FViewportViewBatcher
+{
+public:
+	FViewportViewBatcher();
+	~FViewportViewBatcher();
+
+	/** Queues a view of the viewport, rendered from its client into the batch of its scene at the end of the frame */
+	void AddView(SViewportWidget* Viewport, const TSharedRef<FCustomPreviewScene>& Scene, FIntPoint Size);
+
+	/** Forgets the viewport, e.g. once it stops batching or is destroyed */
+	void RemoveViewport(SViewportWidget* Viewport);
+
+	/**
+	 * @param OutRenderTarget	Atlas the last batched view of the viewport was rendered into
+	 * @param OutRect			Rect of the view in the atlas, in pixels
+	 * @return True if the viewport has a batched view to show
+	 */
+	bool GetViewTarget(const SViewportWidget* Viewport, UTextureRenderTarget2D*& OutRenderTarget, FIntRect& OutRect) const;
+
+	/** Renders the views queued this frame, one family per scene. Called at the end of each frame */
+	void RenderBatches();
+
+	/** Destroys the atlases */
+	void Reset();
+
+private:
+	struct FBatchedView
+	{
+		SViewportWidget* Viewport;
+
+		FIntPoint Size;
+
+		/** Rect of the view in the atlas since it was last rendered */
+		FIntRect Rect;
+
+		/** True if the view was queued this frame */
+		bool bQueued;
+	};
+
+	struct FSceneBatch
+	{
+		TWeakPtr<FCustomPreviewScene> Scene;
+
+		TStrongObjectPtr<UTextureRenderTarget2D> RenderTarget;
+
+		TArray<FBatchedView> Views;
+	};
+
+	void RenderBatch(FSceneBatch& Batch);
+
+	/** Places the queued views of a batch in rows and returns the size of the atlas they need */
+	static FIntPoint LayoutViews(TArray<FBatchedView>& Views);
+
+	TMap<const FCustomPreviewScene*, FSceneBatch> Batches;
+
+	FDelegateHandle EndFrameHandle;
+};
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "UObject/ObjectMacros.h"
+#include "Engine/EngineBaseTypes.h"
 #include "ViewportWidgetEntry.generated.h"
 
 class AActor;
@@ -20,6 +21,160 @@ enum class ECustomViewportType :uint8
 	CVT_OrthoNegativeYZ = 7	UMETA(DisplayName = "Ortho Right"),
 };
 
+UENUM(BlueprintType)
+enum class EViewportWidgetRedrawMode :uint8
+{
+	/** Renders the scene every frame */
+	Realtime = 0			UMETA(DisplayName = "Realtime"),
+	/** Renders only when the camera, entries or lighting change, or when an entry actor moves or animates */
+	OnDemand = 1			UMETA(DisplayName = "On Demand"),
+	/** Renders a few frames when the camera, entries or lighting change, then freezes the preview world and keeps showing the last frame */
+	Snapshot = 2			UMETA(DisplayName = "Snapshot"),
+};
+
+UENUM(BlueprintType)
+enum class EViewportWidgetWorldProfile :uint8
+{
+	/** A preview world with physics and audio, for entries that simulate or play sounds */
+	Full = 0				UMETA(DisplayName = "Full"),
+	/** A world that only displays its entries: no physics scene, no audio, and entry actors spawn without collision */
+	DisplayOnly = 1			UMETA(DisplayName = "Display Only"),
+};
+
+//------------------------------------------------------
+// FViewportWidgetTickPolicy
+//------------------------------------------------------
+
+USTRUCT(BlueprintType)
+struct VIEWPORTWIDGET_API FViewportWidgetTickPolicy
+{
+	GENERATED_BODY()
+
+public:
+	/** Rate at which the preview world ticks, in Hz. Frame time is accumulated in between. 0 ticks every frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetTickPolicy", meta = (ClampMin = "0"))
+	float TickRate = 0.f;
+
+	/** Only advance the world time, without ticking actors and components */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetTickPolicy")
+	bool bTimeOnly = false;
+
+	/** Stop ticking the world entirely on frames where the viewport has nothing to redraw. Only matters for the On Demand redraw mode */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetTickPolicy")
+	bool bPauseWhenStatic = false;
+};
+
+//------------------------------------------------------
+// FViewportWidgetResolutionSettings
+//------------------------------------------------------
+
+USTRUCT(BlueprintType)
+struct VIEWPORTWIDGET_API FViewportWidgetResolutionSettings
+{
+	GENERATED_BODY()
+
+public:
+	/** Lower and raise the resolution to keep the measured GPU time of the viewport around the target. Needs timestamp query support from the RHI */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetResolutionSettings")
+	bool bAdaptive = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetResolutionSettings", meta = (EditCondition = "bAdaptive", ClampMin = "0.1"))
+	float TargetGPUTimeMs = 2.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetResolutionSettings", meta = (EditCondition = "bAdaptive", ClampMin = "0.1", ClampMax = "1"))
+	float MinResolutionFraction = .5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetResolutionSettings", meta = (ClampMin = "0.1", ClampMax = "2"))
+	float MaxResolutionFraction = 1.f;
+
+	/** Render at most one pixel per Slate unit, so high DPI windows do not multiply the rendered pixels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetResolutionSettings")
+	bool bCapAtLogicalResolution = false;
+
+	/** Largest rendered width or height in pixels, 0 for no limit */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetResolutionSettings", meta = (ClampMin = "0"))
+	int32 MaxRenderSize = 0;
+
+	bool operator==(const FViewportWidgetResolutionSettings& Other) const
+	{
+		return bAdaptive == Other.bAdaptive
+			&& TargetGPUTimeMs == Other.TargetGPUTimeMs
+			&& MinResolutionFraction == Other.MinResolutionFraction
+			&& MaxResolutionFraction == Other.MaxResolutionFraction
+			&& bCapAtLogicalResolution == Other.bCapAtLogicalResolution
+			&& MaxRenderSize == Other.MaxRenderSize;
+	}
+
+	bool operator!=(const FViewportWidgetResolutionSettings& Other) const { return !(*this == Other); }
+};
+
+//------------------------------------------------------
+// FViewportWidgetQualityProfile
+//------------------------------------------------------
+
+/** Rendering features a viewport pays for. Profiles are named in the Viewport Widget project settings and picked per widget */
+USTRUCT(BlueprintType)
+struct VIEWPORTWIDGET_API FViewportWidgetQualityProfile
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetQualityProfile")
+	TEnumAsByte<EAntiAliasingMethod> AntiAliasingMethod = AAM_FXAA;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetQualityProfile")
+	bool bAmbientOcclusion = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetQualityProfile")
+	bool bScreenSpaceReflections = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetQualityProfile")
+	bool bDynamicShadows = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetQualityProfile")
+	bool bFog = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetQualityProfile")
+	bool bBloom = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetQualityProfile")
+	bool bEyeAdaptation = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetQualityProfile")
+	bool bDepthOfField = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetQualityProfile")
+	bool bMotionBlur = false;
+
+	/** Occlusion queries only pay off in scenes with many occluded objects, which previews rarely are */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetQualityProfile")
+	bool bOcclusionQueries = false;
+
+	/** Any other show flag by name, e.g. "LensFlares" or "Decals", applied after the toggles above */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetQualityProfile")
+	TMap<FString, bool> ShowFlagOverrides;
+};
+
+//------------------------------------------------------
+// FViewportThumbnailCamera
+//------------------------------------------------------
+
+USTRUCT(BlueprintType)
+struct VIEWPORTWIDGET_API FViewportThumbnailCamera
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportThumbnailCamera")
+	FTransform ViewTransform;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportThumbnailCamera")
+	float FOV = 90.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportThumbnailCamera")
+	FLinearColor BackgroundColor = FLinearColor::Black;
+};
+
 //------------------------------------------------------
 // FViewportWidgetEntry
 //------------------------------------------------------
@@ -39,6 +194,10 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="ViewportWidgetEntry")
 	FTransform SpawnTransform;
+
+	/** If false, the actor and its components do not tick in the preview world */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "ViewportWidgetEntry")
+	bool bTickInPreview = true;
 	
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "ViewportWidgetEntry")
 	TWeakObjectPtr<AActor> ActorObjectPtr;
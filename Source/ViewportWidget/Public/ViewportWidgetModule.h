@@ -3,6 +3,14 @@
 #pragma once
 
 #include "Modules/ModuleManager.h"
+#include "ViewportRenderScheduler.h"
+#include "ViewportThumbnailRenderer.h"
+#include "ViewportThumbnailCache.h"
+#include "ViewportViewBatcher.h"
+#include "ViewportWidgetEntry.h"
+
+class FCustomPreviewScene;
+class SViewportWidget;
 
 //------------------------------------------------------
 // FViewportWidgetModule
@@ -13,4 +21,43 @@ class FViewportWidgetModule : public IModuleInterface
 public:
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+	/** @return The module if it is loaded, nullptr while it is starting up or shutting down */
+	static FViewportWidgetModule* GetPtr() { return FModuleManager::GetModulePtr<FViewportWidgetModule>("ViewportWidget"); }
+
+	FViewportRenderScheduler& GetRenderScheduler() { return RenderScheduler; }
+
+	/** @return The preview scene shared by all viewports using this name, created on first use and destroyed with its last user */
+	TSharedRef<FCustomPreviewScene> FindOrCreateSharedPreviewScene(FName Name, EViewportWidgetWorldProfile WorldProfile = EViewportWidgetWorldProfile::Full);
+
+	/** Keeps a released viewport, with its preview scene and spawned actors, so it can be reattached by the next widget using the key */
+	void ParkViewport(FName Key, const TSharedRef<SViewportWidget>& Viewport);
+
+	/** @return The viewport parked under the key, removed from the cache, or nullptr */
+	TSharedPtr<SViewportWidget> UnparkViewport(FName Key);
+
+	/** Destroys the viewport parked under the key */
+	void ReleaseParkedViewport(FName Key);
+
+	void ReleaseAllParkedViewports();
+
+	FViewportThumbnailRenderer& GetThumbnailRenderer() { return ThumbnailRenderer; }
+
+	FViewportThumbnailCache& GetThumbnailCache() { return ThumbnailCache; }
+
+	FViewportViewBatcher& GetViewBatcher() { return ViewBatcher; }
+
+private:
+	FViewportRenderScheduler RenderScheduler;
+
+	FViewportThumbnailRenderer ThumbnailRenderer;
+
+	FViewportThumbnailCache ThumbnailCache;
+
+	FViewportViewBatcher ViewBatcher;
+
+	TMap<FName, TWeakPtr<FCustomPreviewScene>> SharedPreviewScenes;
+
+	/** Parked viewports, least recently parked first */
+	TArray<TPair<FName, TSharedPtr<SViewportWidget>>> ParkedViewports;
 };
\ No newline at end of file
@@ -0,0 +1,27 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "Engine/DeveloperSettings.h"
+#include "ViewportWidgetEntry.h"
+#include "ViewportWidgetSettings.generated.h"
+
+//------------------------------------------------------
+// UViewportWidgetSettings
+//------------------------------------------------------
+
+UCLASS(config = Game, defaultconfig, meta = (DisplayName = "Viewport Widget"))
+class VIEWPORTWIDGET_API UViewportWidgetSettings : public UDeveloperSettings
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	/** Quality profiles viewport widgets can pick by name. Comes with Thumbnail, Portrait and Hero */
+	UPROPERTY(config, EditAnywhere, Category = Quality)
+	TMap<FName, FViewportWidgetQualityProfile> QualityProfiles;
+
+	/** @return The profile with this name, nullptr if there is none */
+	static const FViewportWidgetQualityProfile* FindQualityProfile(FName Name);
+
+	virtual FName GetCategoryName() const override { return TEXT("Plugins"); }
+};
@@ -0,0 +1,19 @@
+// Copyright 2024 Pentangle Studio under EULA https://www.unrealengine.com/en-US/eula/unreal
+
+#pragma once
+
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+//------------------------------------------------------
+// ViewportWidget stats
+//------------------------------------------------------
+
+DECLARE_STATS_GROUP(TEXT("ViewportWidget"), STATGROUP_ViewportWidget, STATCAT_Advanced);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Viewport Widgets"), STAT_ViewportWidget_NumWidgets, STATGROUP_ViewportWidget, VIEWPORTWIDGET_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Preview Worlds"), STAT_ViewportWidget_NumPreviewWorlds, STATGROUP_ViewportWidget, VIEWPORTWIDGET_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Entry Actors"), STAT_ViewportWidget_NumEntryActors, STATGROUP_ViewportWidget, VIEWPORTWIDGET_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Renders"), STAT_ViewportWidget_NumRenders, STATGROUP_ViewportWidget, VIEWPORTWIDGET_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(VIEWPORTWIDGET_API, ViewportWidget);
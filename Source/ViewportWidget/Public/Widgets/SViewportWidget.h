@@ -4,13 +4,21 @@
 
 #include "Widgets/SViewport.h"
 #include "ViewportWidgetEntry.h"
+#include "ViewportFrameReadback.h"
 #include "Components/Viewport.h"
+#include "UObject/StrongObjectPtr.h"
 
 class FSceneViewport;
 class FCustomViewportClient;
 class FCustomUMGViewportClient;
 class FCustomPreviewScene;
 class FPreviewScene;
+class UTexture2D;
+class UTextureRenderTarget2D;
+class UTextureCube;
+class SBox;
+enum class EPreviewActorOrigin : uint8;
+struct FStreamableHandle;
 
 //------------------------------------------------------
 // SViewportWidget
@@ -19,30 +27,130 @@ class FPreviewScene;
 class VIEWPORTWIDGET_API SViewportWidget : public SViewport
 {
 public:
-	SLATE_BEGIN_ARGS(SViewportWidget) :_ViewportSize(SViewport::FArguments::GetDefaultViewportSize()), _ViewTransform(FTransform::Identity), _Entries(FViewportWidgetEntry::GetEmptyCollection()) {}
+	SLATE_BEGIN_ARGS(SViewportWidget) :_ViewportSize(SViewport::FArguments::GetDefaultViewportSize()), _ViewTransform(FTransform::Identity), _Entries(FViewportWidgetEntry::GetEmptyCollection()), _SharedSceneName(NAME_None), _AsyncLoadEntries(false), _ThumbnailCacheKey(0), _WorldProfile(EViewportWidgetWorldProfile::Full) {}
 	SLATE_ATTRIBUTE(FVector2D, ViewportSize);
 	SLATE_ATTRIBUTE(FTransform, ViewTransform);
 	SLATE_ATTRIBUTE(TArray<FViewportWidgetEntry>, Entries);
+	/** If set, the viewport renders from the preview scene shared by all viewports using this name instead of its own */
+	SLATE_ARGUMENT(FName, SharedSceneName);
+	/** If true, entry classes that are not loaded yet are streamed in asynchronously and the previous entries stay on screen meanwhile */
+	SLATE_ARGUMENT(bool, AsyncLoadEntries);
+	/** Called once the actors of new entries have been spawned */
+	SLATE_EVENT(FSimpleDelegate, OnEntriesReady);
+	/** Key of the persistent thumbnail cache for what the viewport shows, 0 to not use the cache */
+	SLATE_ARGUMENT(uint64, ThumbnailCacheKey);
+	/** What the preview world supports besides displaying its entries. A shared scene gets the profile of the viewport that creates it */
+	SLATE_ARGUMENT(EViewportWidgetWorldProfile, WorldProfile);
 	SLATE_END_ARGS()
 
 	SViewportWidget();
+	virtual ~SViewportWidget();
 
 	void Construct(const FArguments& InArgs);
 
+	/** Sets the widgets drawn over the viewport. They stay above the image standing in for the scene, see GetStandInBrush */
+	void SetContent(TSharedPtr<SWidget> InContent);
+
 	void SetViewTransform(const FTransform& viewTransform);
 
 	void SetEntries(TArray<FViewportWidgetEntry>& entries);
 
+	/** Defers loading new entries and looking up the thumbnail cache until the matching EndUpdate, so several changes in a row do it once. Updates nest */
+	void BeginUpdate() { UpdateDepth++; }
+
+	/** Ends an update started by BeginUpdate, doing the deferred work if it is the outermost one */
+	void EndUpdate();
+
+	void SetAsyncLoadEntries(bool bInAsyncLoadEntries) { bAsyncLoadEntries = bInAsyncLoadEntries; }
+
+	void SetOnEntriesReady(const FSimpleDelegate& InOnEntriesReady) { OnEntriesReady = InOnEntriesReady; }
+
+	/** @return True while entry classes are being loaded and the viewport still shows the previous entries */
+	bool IsLoadingEntries() const { return bHasPendingEntries; }
+
+	/** Sets how many removed entry actors are kept per class for reuse */
+	void SetEntryActorPoolSize(int32 poolSize);
+
+	/**
+	 * The preview world is only created, and the entries loaded and spawned, once the viewport is first on screen.
+	 * This does it right away instead, e.g. while a menu is opening so its previews are ready when it shows.
+	 */
+	void Prewarm();
+
+	/** @return True once the preview world exists */
+	bool HasPreviewScene() const { return PreviewScene.IsValid(); }
+
+	/**
+	 * Shows these actors of their own world, usually the game world, instead of spawning the entries in a preview world.
+	 * The viewport renders that world's scene restricted to their primitives, with its lighting and post processing,
+	 * and only its own camera. All actors must be in the same world. An empty list goes back to the preview world
+	 */
+	void SetMirroredActors(const TArray<AActor*>& actors);
+
+	bool IsMirroringWorld() const { return MirroredActors.Num() > 0; }
+
+	/**
+	 * Renders the viewport's view in a single view family with the other viewports of its shared scene that batch theirs, into a shared atlas
+	 * it then draws from. The scene setup is done once for all of them, the image shows a frame later. Only applies with a shared scene
+	 */
+	void SetBatchViews(bool bInBatchViews);
+
+	/**
+	 * Reads the last rendered frame back to CPU memory without flushing the render thread or waiting for the GPU.
+	 * The delegate is called on the game thread, from a tick of the viewport a few frames later
+	 */
+	void RequestFrameReadback(const FOnViewportFrameRead& OnRead);
+
+	void SetTickPolicy(const FViewportWidgetTickPolicy& InTickPolicy);
+
+	void SetResolutionSettings(const FViewportWidgetResolutionSettings& InResolutionSettings);
+
+	/** Renders with the named profile of the Viewport Widget settings, or the default show flags for None or an unknown name */
+	void SetQualityProfile(FName profileName);
+
+	/**
+	 * Sets the key of the persistent thumbnail cache for what the viewport shows, 0 to not use the cache.
+	 * A viewport whose image is cached shows it without loading its entries until the user interacts with it,
+	 * otherwise it stores its image once it stops redrawing.
+	 */
+	void SetThumbnailCacheKey(uint64 key);
+
 	void SetViewportBackgroudColor(FLinearColor InColor);
 	void SetViewportFOV(float InFOV);
+	/** The sky is recaptured over the next frames, only if the cubemap changed */
 	void SetViewportCubemap(UTextureCube* InCubemap);
+
+	/** Makes sure the sky light and reflections were captured, recapturing over the next frames if the environment changed */
 	void UpdateCapture();
+
+	/** Recaptures the sky light and reflections over the next frames, e.g. after reflection captures were spawned */
+	void InvalidateCapture();
+
 	void SetViewportSkyBrightness(float brightness);
 	void SetViewportLightBrightness(float brightness);
 	void SetViewportLightDirection(FRotator& InLightDir);
 
+	void SetRedrawMode(EViewportWidgetRedrawMode InRedrawMode);
+	EViewportWidgetRedrawMode GetRedrawMode() const { return RedrawMode; }
+
+	/** Marks the viewport dirty so the scene is rendered on the next tick */
+	void RequestRedraw() { bRedrawRequested = true; }
+
+	/** Keeps the viewport rendering every frame for the given number of seconds, whatever the redraw mode */
+	void SetRealtimeForDuration(float Seconds);
+
+	/** Sets how many frames the Snapshot redraw mode renders before freezing, so temporal effects can settle */
+	void SetSnapshotFrameCount(int32 frameCount);
+
+	/** @return True if the viewport is in Snapshot mode and showing its frozen frame */
+	bool IsSnapshotFrozen() const;
+
 	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
 
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+
+	virtual void OnMouseEnter(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent) override;
+
 	/** @return True if the viewport is currently visible */
 	virtual bool IsVisible() const;
 
@@ -58,23 +166,230 @@ public:
 protected:
 
 	void CleanEntries();
-	void AddEntries();
+
+	/**
+	 * Replaces the current entries with new ones, touching only what differs:
+	 * entries with the same class keep their actor and are moved if their transform changed,
+	 * only added, removed or class-changed entries spawn or destroy actors.
+	 */
+	void ReconcileEntries(TArray<FViewportWidgetEntry>& newEntries);
+
+	/** Starts loading the classes of the pending entries, or spawns them right away if they are all resident */
+	void LoadPendingEntries();
+
+	/** Replaces the current entries with the pending ones once their classes are loaded */
+	void ApplyPendingEntries();
+
+	/** Spawns the actor of an entry, or takes the matching one from the shared scene */
+	AActor* SpawnEntryActor(UClass* actorClass, const FTransform& spawnTransform, UWorld* world);
+	void DestroyEntryActor(AActor* actor, UWorld* world);
+
+	/** @return The actor now showing the entry at its new transform, a different one if a shared actor had to be split off */
+	AActor* MoveEntryActor(AActor* actor, const FTransform& spawnTransform, UWorld* world);
+
+	/** Limits a shared scene's rendering to the primitives of our own entries, or a mirrored world's to the mirrored actors */
+	void UpdateShowOnlyPrimitives();
+
+	/** @return The actors the viewport shows: the mirrored ones, or those of the entries with null for entries not spawned */
+	void GetDisplayedActors(TArray<const AActor*>& OutActors) const;
 
 	virtual void SetupSpawnedActor(AActor* actor, UWorld* world) {}
 
+	/** Called instead of SetupSpawnedActor when an entry reuses a pooled actor, to undo what the previous entry did to it */
+	virtual void ResetPooledActor(AActor* actor, UWorld* world) {}
+
+	/** Runs the setup or reset hook an actor needs depending on where it comes from */
+	void PrepareEntryActor(AActor* actor, EPreviewActorOrigin origin, UWorld* world);
+
+	/** Turns the ticking of an entry actor and its components on or off as the entry asks */
+	static void ApplyEntryTickSetting(const FViewportWidgetEntry& entry);
+
+	/** Ticks the preview world according to the tick policy */
+	void TickPreviewWorld(float InDeltaTime);
+
+	/** Picks the resolution fraction of the next render from the resolution settings and the measured GPU time */
+	void UpdateResolutionFraction();
+
+	/** Registers the view with the texture streamer for the viewport's pixel size, and redraws as the mips it asked for arrive */
+	void UpdateTextureStreaming(double InCurrentTime);
+
+	/** @return True if the scene has to be rendered this tick */
+	bool ShouldRedraw(const double InCurrentTime);
+
+	/** @return True if the viewport has focus or is hovered, in which case the render scheduler lets it render at full rate */
+	bool IsHighRenderPriority() const;
+
+	/** @return True if any entry actor moved or is animating since the last check */
+	bool HaveEntryActorsChanged();
+
+	/** Refreshes bIsOnScreen from the widget hierarchy, the clipping and the owning window */
+	void UpdateVisibility(const FGeometry& AllottedGeometry, const double InCurrentTime);
+
+	/** @return True if other widgets are on top of the viewport at every sampled point */
+	bool IsCoveredByOtherWidgets(const FGeometry& AllottedGeometry) const;
+
+	/** @return True if the thumbnail cache has an image for the current key, now set as CachedThumbnailBrush */
+	bool LoadCachedThumbnail();
+
+	/** Leaves the cached image for the live scene, loading the entries held back meanwhile */
+	void WakeFromCachedThumbnail();
+
+	/** Shows the cached image of the current key, or the live scene if there is none */
+	void RefreshCachedThumbnail();
+
+	/** Creates the preview world on first use, applies the settings it missed and loads the pending entries */
+	void EnsurePreviewScene();
+
+	/** Stores the last rendered frame in the thumbnail cache */
+	void CaptureThumbnail();
+
+	/** @return The image drawn over the viewport in place of the scene: the cached thumbnail or the batched view, or nullptr */
+	const FSlateBrush* GetStandInBrush() const;
+
+	/** @return True if the view renders in the batch of the shared scene rather than through the scene viewport */
+	bool ShouldBatchView() const;
+
+	/** @return True if the view has been rendered in the batch, with the atlas and the rect it was rendered into */
+	bool GetBatchedViewTarget(UTextureRenderTarget2D*& OutRenderTarget, FIntRect& OutRect) const;
+
+	/** Points BatchedViewBrush at the view's rect of the batch atlas, or clears it if the view is not batched */
+	void UpdateBatchedViewBrush();
+
 protected:
 	/** Viewport that renders the scene provided by the viewport client */
 	TSharedPtr<FSceneViewport> SceneViewport;
 
+	/** Holds the content set by SetContent, above the stand-in image */
+	TSharedPtr<SBox> ContentBox;
+
 	/** The client responsible for setting up the scene */
 	TSharedPtr<FCustomUMGViewportClient> Client;
 
 	/** The last time the viewport was ticked (for visibility determination) */
 	double LastTickTime;
 
-	TSharedPtr<FPreviewScene> PreviewScene;
+	/** Result of the last visibility check */
+	bool bIsOnScreen;
+
+	/** The last time the viewport was tested for being covered by other widgets */
+	double LastOcclusionCheckTime;
+
+	/** Result of the last occlusion test, refreshed every VisibilityTimeThreshold */
+	bool bIsCovered;
+
+	/** Culling rect of the last paint, used to detect a viewport clipped away by its parents */
+	mutable FSlateRect LastCullingRect;
+
+	/** Window the viewport was last found in, cached to avoid searching the window list every tick */
+	TWeakPtr<SWindow> CachedWindow;
+
+	TSharedPtr<FCustomPreviewScene> PreviewScene;
+
+	/** True if PreviewScene is shared with other viewports */
+	bool bUsesSharedScene;
+
+	/** Name of the shared preview scene to use once it is created */
+	FName SharedSceneName;
+
+	/** Actors of another world shown instead of the entries */
+	TArray<TWeakObjectPtr<AActor>> MirroredActors;
+
+	bool bBatchViews;
+
+	/** The view's rect of the batch atlas, drawn instead of the scene viewport while the view is batched */
+	FSlateBrush BatchedViewBrush;
+
+	/** Scene settings received before the preview scene was created, applied to it once it is */
+	TOptional<float> PendingSkyBrightness;
+	TOptional<float> PendingLightBrightness;
+	TOptional<FRotator> PendingLightDirection;
+	TOptional<TWeakObjectPtr<UTextureCube>> PendingCubemap;
+	bool bPendingCaptureRequest;
+	bool bPendingCaptureInvalidation;
+
+	int32 EntryActorPoolSize;
+
+	EViewportWidgetWorldProfile WorldProfile;
 
 	TAttribute<FTransform> ViewTransform;
 
 	TAttribute<TArray<FViewportWidgetEntry>> Entries;
+
+	/** Entries waiting for their classes to load */
+	TArray<FViewportWidgetEntry> PendingEntries;
+
+	bool bHasPendingEntries;
+
+	bool bAsyncLoadEntries;
+
+	/** Batched load of the pending entry classes */
+	TSharedPtr<FStreamableHandle> EntriesLoadHandle;
+
+	FSimpleDelegate OnEntriesReady;
+
+	FViewportWidgetTickPolicy TickPolicy;
+
+	/** Frame time not yet given to the preview world when ticking at a fixed rate */
+	float TickAccumulator;
+
+	FViewportWidgetResolutionSettings ResolutionSettings;
+
+	/** Name of the quality profile given to the client */
+	FName QualityProfileName;
+
+	EViewportWidgetRedrawMode RedrawMode;
+
+	/** True if a setter changed what the viewport shows since the last render */
+	bool bRedrawRequested;
+
+	/** Time until which the viewport keeps rendering every frame */
+	double RealtimeEndTime;
+
+	/** Nesting depth of BeginUpdate */
+	int32 UpdateDepth;
+
+	/** Entries set during the current update, loaded at its end */
+	bool bEntriesChangedInUpdate;
+
+	/** Thumbnail cache key changed during the current update, looked up at its end */
+	bool bThumbnailCacheKeyChangedInUpdate;
+
+	/** Frames rendered in Snapshot mode after each change */
+	int32 SnapshotFrameCount;
+
+	/** Frames left to render before the snapshot freezes */
+	int32 SnapshotFramesRemaining;
+
+	/** Size of the scene viewport when it was last rendered */
+	FIntPoint LastRenderedSize;
+
+	/** Capture generation of the preview scene when the viewport was last rendered */
+	uint32 LastCaptureGeneration;
+
+	/** Time until which textures streamed in trigger a redraw, after the last change */
+	double TextureStreamingEndTime;
+
+	/** Resources the texture streamer was still streaming in at the last tick */
+	int32 LastNumWantingStreamingResources;
+
+	/** Entry actor transforms when the viewport was last rendered, used to detect movement */
+	TArray<FTransform> LastEntryActorTransforms;
+
+	uint64 ThumbnailCacheKey;
+
+	/** True while the viewport shows its cached image and has not loaded its entries */
+	bool bShowingCachedThumbnail;
+
+	/** True until the user interacts with the viewport or its entries are spawned, while a cached image may stand in for them */
+	bool bAwaitingInteraction;
+
+	/** True once the image for the current key has been stored */
+	bool bThumbnailCaptured;
+
+	/** Image drawn over the viewport until the live scene has rendered */
+	TStrongObjectPtr<UTexture2D> CachedThumbnailTexture;
+	FSlateBrush CachedThumbnailBrush;
+
+	/** Created by the first readback request */
+	TUniquePtr<FViewportFrameReadback> FrameReadback;
 };
\ No newline at end of file
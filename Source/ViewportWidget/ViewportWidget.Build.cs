@@ -30,6 +30,7 @@ public class ViewportWidget : ModuleRules
                 "SlateCore",
                 "UMG",
                 "Engine",
+                "DeveloperSettings",
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);